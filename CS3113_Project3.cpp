@@ -2,13 +2,702 @@
 #include <queue>
 #include <string>
 #include <vector>
-#include <list>
-#include <iterator>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <condition_variable>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
 using namespace std;
 
+// Dispatch micro-ops through computed gotos where the compiler supports them
+// (build with -DTHREADED_DISPATCH=0 to force the portable switch loop)
+#ifndef THREADED_DISPATCH
+#if defined(__GNUC__) || defined(__clang__)
+#define THREADED_DISPATCH 1
+#else
+#define THREADED_DISPATCH 0
+#endif
+#endif
+
+// Scheduling policies, chosen at startup
+enum schedulingPolicy
+{
+    SCHEDULE_ROUND_ROBIN, // FIFO ready queue, fixed time slice
+    SCHEDULE_SJF,         // fewest remaining instructions first, runs until IO or termination
+    SCHEDULE_SRTF,        // fewest remaining instructions first, preempted every time slice
+    SCHEDULE_PRIORITY,    // lowest priority value first, round robin among equals
+    SCHEDULE_MLFQ,        // feedback queues, a process that uses its whole slice moves down a level
+    NUM_SCHEDULING_POLICIES
+};
+
+const char *const policyNames[NUM_SCHEDULING_POLICIES] = {"rr", "sjf", "srtf", "priority", "mlfq"};
+
+// Page replacement policies of the paged memory mode
+enum replacementPolicy
+{
+    REPLACE_CLOCK,       // second chance: the hand skips, and clears, referenced pages
+    REPLACE_LRU,         // least recently used page
+    REPLACE_WORKING_SET, // WSClock: first page past the working set window, least recently used if none is
+    NUM_REPLACEMENT_POLICIES
+};
+
+const char *const replacementNames[NUM_REPLACEMENT_POLICIES] = {"clock", "lru", "ws"};
+
+// Verbosity levels of the event log, each level includes the ones before it
+enum logLevel
+{
+    LOG_OFF,
+    LOG_SUMMARY,      // process reports, final clock and errors
+    LOG_TRANSITIONS,  // state transitions and memory allocation
+    LOG_INSTRUCTIONS  // every executed instruction and the memory dump
+};
+
+// Event types, the payload of each is listed next to it
+enum logEventType
+{
+    EVENT_JOB_LOADED,        // address, size
+    EVENT_NO_MEMORY,
+    EVENT_DUPLICATE_JOB,
+    EVENT_RUNNING,
+    EVENT_COMPUTE,
+    EVENT_STORED,
+    EVENT_STORE_ERROR,
+    EVENT_LOADED,
+    EVENT_LOAD_ERROR,
+    EVENT_INVALID_OPCODE,    // opcode
+    EVENT_IO_INTERRUPT,
+    EVENT_IO_COMPLETE,
+    EVENT_TIMEOUT,
+    EVENT_READY,
+    EVENT_TERMINATED,        // PC, instruction base, data base, memory limit, CPU cycles used,
+                             // register, max memory needed, main memory base, start time, end time
+    EVENT_MEMORY_RELEASED,   // first address, last address
+    EVENT_FREE_ERROR,
+    EVENT_MEMORY_WORD,       // address, value
+    EVENT_TOTAL_TIME,
+    EVENT_MEMORY_VIOLATION,  // logical address
+    EVENT_SEGMENT_OVERFLOW,
+    EVENT_SEGMENT_ALLOCATED, // segment number, address, size
+    EVENT_TRANSLATION_STATS, // segment hits, cache hits, misses
+    EVENT_SCHEDULE_REPORT,   // policy, processes completed, total turnaround, total response
+    EVENT_CORE_REPORT,       // core, busy cycles, dispatches, steals, migrations
+    EVENT_PROCESS_RELOCATED, // segment number, old address, new address, size
+    EVENT_COMPACTION_REPORT, // relocations, words moved
+    EVENT_MEMORY_DUMP,       // memory size
+    EVENT_MEMORY_REGION,     // first address, last address, segment number (PID: owner, -1 if free)
+    EVENT_MEMORY_RUN,        // first address, last address, value
+    EVENT_JOB_BACKFILLED,    // PID of the blocked head
+    EVENT_MEMORY_RESERVED,   // cycles the head has been blocked
+    EVENT_BACKFILL_REPORT,   // jobs backfilled, reservations
+    EVENT_PAGE_FAULT,        // page
+    EVENT_PAGE_EVICTED,      // page, frame address
+    EVENT_PAGING_REPORT,     // policy, page size, references, faults, swap-ins, swap-outs, evictions, stall cycles
+    EVENT_FORKED,            // child PID
+    EVENT_FORK_FAILED,       // child PID
+    EVENT_COW_FAULT,         // page
+    EVENT_FORK_REPORT,       // forks, failed forks, copy-on-write faults, words copied, peak words shared
+    EVENT_FILLED,
+    EVENT_COPIED,
+    EVENT_SUMMED,
+    EVENT_BULK_ERROR,
+    EVENT_BULK_REPORT,       // bulk instructions, words covered, cycles
+    EVENT_MEMORY_COALESCED,
+    EVENT_JOB_WAITING,
+    NUM_EVENT_TYPES
+};
+
+// Verbosity level each event type is recorded at
+const int eventLevels[NUM_EVENT_TYPES] = {
+    LOG_TRANSITIONS,  // EVENT_JOB_LOADED
+    LOG_TRANSITIONS,  // EVENT_NO_MEMORY
+    LOG_SUMMARY,      // EVENT_DUPLICATE_JOB
+    LOG_TRANSITIONS,  // EVENT_RUNNING
+    LOG_INSTRUCTIONS, // EVENT_COMPUTE
+    LOG_INSTRUCTIONS, // EVENT_STORED
+    LOG_INSTRUCTIONS, // EVENT_STORE_ERROR
+    LOG_INSTRUCTIONS, // EVENT_LOADED
+    LOG_INSTRUCTIONS, // EVENT_LOAD_ERROR
+    LOG_INSTRUCTIONS, // EVENT_INVALID_OPCODE
+    LOG_TRANSITIONS,  // EVENT_IO_INTERRUPT
+    LOG_TRANSITIONS,  // EVENT_IO_COMPLETE
+    LOG_TRANSITIONS,  // EVENT_TIMEOUT
+    LOG_TRANSITIONS,  // EVENT_READY
+    LOG_SUMMARY,      // EVENT_TERMINATED
+    LOG_TRANSITIONS,  // EVENT_MEMORY_RELEASED
+    LOG_SUMMARY,      // EVENT_FREE_ERROR
+    LOG_INSTRUCTIONS, // EVENT_MEMORY_WORD
+    LOG_SUMMARY,      // EVENT_TOTAL_TIME
+    LOG_SUMMARY,      // EVENT_MEMORY_VIOLATION
+    LOG_SUMMARY,      // EVENT_SEGMENT_OVERFLOW
+    LOG_TRANSITIONS,  // EVENT_SEGMENT_ALLOCATED
+    LOG_SUMMARY,      // EVENT_TRANSLATION_STATS
+    LOG_SUMMARY,      // EVENT_SCHEDULE_REPORT
+    LOG_SUMMARY,      // EVENT_CORE_REPORT
+    LOG_TRANSITIONS,  // EVENT_PROCESS_RELOCATED
+    LOG_SUMMARY,      // EVENT_COMPACTION_REPORT
+    LOG_SUMMARY,      // EVENT_MEMORY_DUMP
+    LOG_SUMMARY,      // EVENT_MEMORY_REGION
+    LOG_SUMMARY,      // EVENT_MEMORY_RUN
+    LOG_TRANSITIONS,  // EVENT_JOB_BACKFILLED
+    LOG_TRANSITIONS,  // EVENT_MEMORY_RESERVED
+    LOG_SUMMARY,      // EVENT_BACKFILL_REPORT
+    LOG_INSTRUCTIONS, // EVENT_PAGE_FAULT
+    LOG_INSTRUCTIONS, // EVENT_PAGE_EVICTED
+    LOG_SUMMARY,      // EVENT_PAGING_REPORT
+    LOG_TRANSITIONS,  // EVENT_FORKED
+    LOG_SUMMARY,      // EVENT_FORK_FAILED
+    LOG_INSTRUCTIONS, // EVENT_COW_FAULT
+    LOG_SUMMARY,      // EVENT_FORK_REPORT
+    LOG_INSTRUCTIONS, // EVENT_FILLED
+    LOG_INSTRUCTIONS, // EVENT_COPIED
+    LOG_INSTRUCTIONS, // EVENT_SUMMED
+    LOG_INSTRUCTIONS, // EVENT_BULK_ERROR
+    LOG_SUMMARY,      // EVENT_BULK_REPORT
+    LOG_TRANSITIONS,  // EVENT_MEMORY_COALESCED
+    LOG_TRANSITIONS   // EVENT_JOB_WAITING
+};
+
+// Binary log file layout: the magic string, then one record per event made of
+// clock (int64), PID (int64), event type (uint16), payload count (uint16) and
+// the payload values (int64 each), all little endian
+const char LOG_MAGIC[8] = {'O', 'S', 'S', 'I', 'M', 'L', 'G', '1'};
+const size_t LOG_FLUSH_SIZE = 1 << 20;
+
+struct logWriter;
+
+// Buffered event log, events are rendered as text or appended as binary
+// records and written out in large batches
+struct eventLog
+{
+    int level = LOG_INSTRUCTIONS;
+    bool binary = false;
+    FILE *out = stdout;
+    string buffer;
+    logWriter *writer = NULL; // set when a writer thread renders and writes the log
+};
+
+// Log of the simulation running on this thread, every simulation owns its log
+thread_local eventLog *activeLog = NULL;
+
+void appendNumber(string &out, long long value)
+{
+    char digits[24];
+    char *end = to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+}
+
+// Function to render one event as the simulator's text output
+void renderEvent(string &out, int type, long long clock, long long processID, const long long *payload)
+{
+    switch (type)
+    {
+    case EVENT_JOB_LOADED:
+        out += "Process "; appendNumber(out, processID);
+        out += " loaded into memory at address "; appendNumber(out, payload[0]);
+        out += " with size "; appendNumber(out, payload[1]);
+        out += ".\n";
+        break;
+    case EVENT_NO_MEMORY:
+        out += "Insufficient memory for Process "; appendNumber(out, processID);
+        out += ". Attempting memory coalescing.\n";
+        break;
+    case EVENT_DUPLICATE_JOB:
+        out += "Error: Process "; appendNumber(out, processID);
+        out += " is already resident, job discarded.\n";
+        break;
+    case EVENT_RUNNING:
+        out += "Process "; appendNumber(out, processID);
+        out += " has moved to Running.\n";
+        break;
+    case EVENT_COMPUTE:
+        out += "compute\n";
+        break;
+    case EVENT_STORED:
+        out += "stored\n";
+        break;
+    case EVENT_STORE_ERROR:
+        out += "store error!\n";
+        break;
+    case EVENT_LOADED:
+        out += "loaded\n";
+        break;
+    case EVENT_LOAD_ERROR:
+        out += "load error!\n";
+        break;
+    case EVENT_INVALID_OPCODE:
+        out += "Process "; appendNumber(out, processID);
+        out += " skipped invalid opcode "; appendNumber(out, payload[0]);
+        out += ".\n";
+        break;
+    case EVENT_IO_INTERRUPT:
+        out += "Process "; appendNumber(out, processID);
+        out += " issued an IOInterrupt and moved to the IOWaitingQueue.\n";
+        break;
+    case EVENT_IO_COMPLETE:
+        out += "Process "; appendNumber(out, processID);
+        out += " completed I/O and is moved to the ReadyQueue.\n";
+        break;
+    case EVENT_TIMEOUT:
+        out += "Process "; appendNumber(out, processID);
+        out += " has a TimeOUT interrupt and is moved to the ReadyQueue.\n";
+        break;
+    case EVENT_READY:
+        out += "Process "; appendNumber(out, processID);
+        out += " has moved to Ready state.\n";
+        break;
+    case EVENT_TERMINATED:
+        out += "Process ID: "; appendNumber(out, processID);
+        out += "\nState: TERMINATED\nProgram Counter: "; appendNumber(out, payload[0]);
+        out += "\nInstruction Base: "; appendNumber(out, payload[1]);
+        out += "\nData Base: "; appendNumber(out, payload[2]);
+        out += "\nMemory Limit: "; appendNumber(out, payload[3]);
+        out += "\nCPU Cycles Used: "; appendNumber(out, payload[4]);
+        out += "\nRegister Value: "; appendNumber(out, payload[5]);
+        out += "\nMax Memory Needed: "; appendNumber(out, payload[6]);
+        out += "\nMain Memory Base: "; appendNumber(out, payload[7]);
+        out += "\nTotal CPU Cycles Consumed: "; appendNumber(out, payload[9] - payload[8]);
+        out += "\nProcess "; appendNumber(out, processID);
+        out += " terminated. Entered running state at: "; appendNumber(out, payload[8]);
+        out += ". Terminated at: "; appendNumber(out, payload[9]);
+        out += ". Total Execution Time: "; appendNumber(out, payload[9] - payload[8]);
+        out += ".\n";
+        break;
+    case EVENT_MEMORY_RELEASED:
+        out += "Process "; appendNumber(out, processID);
+        out += " terminated and released memory from "; appendNumber(out, payload[0]);
+        out += " to "; appendNumber(out, payload[1]);
+        out += ".\n";
+        break;
+    case EVENT_FREE_ERROR:
+        out += "Error: Process "; appendNumber(out, processID);
+        out += " not found in memory list for freeing.\n";
+        break;
+    case EVENT_MEMORY_WORD:
+        appendNumber(out, payload[0]);
+        out += " : "; appendNumber(out, payload[1]);
+        out += "\n";
+        break;
+    case EVENT_TOTAL_TIME:
+        out += "Total CPU time used: "; appendNumber(out, clock);
+        out += ".\n";
+        break;
+    case EVENT_MEMORY_VIOLATION:
+        out += "Memory violation: address "; appendNumber(out, payload[0]);
+        out += " out of bounds.\n";
+        break;
+    case EVENT_SEGMENT_OVERFLOW:
+        out += "Error: not enough space in allocated segments to hold process.\n";
+        break;
+    case EVENT_SEGMENT_ALLOCATED:
+        out += "Process "; appendNumber(out, processID);
+        out += " segment "; appendNumber(out, payload[0]);
+        out += " at address "; appendNumber(out, payload[1]);
+        out += " with size "; appendNumber(out, payload[2]);
+        out += ".\n";
+        break;
+    case EVENT_TRANSLATION_STATS:
+        out += "Address translations: "; appendNumber(out, payload[0]);
+        out += " segment hits, "; appendNumber(out, payload[1]);
+        out += " cache hits, "; appendNumber(out, payload[2]);
+        out += " misses.\n";
+        break;
+    case EVENT_SCHEDULE_REPORT:
+    {
+        long long completed = max(payload[1], 1LL);
+        out += "Scheduler ";
+        out += payload[0] >= 0 && payload[0] < NUM_SCHEDULING_POLICIES ? policyNames[payload[0]] : "?";
+        out += ": "; appendNumber(out, payload[1]);
+        out += " processes completed, average turnaround "; appendNumber(out, payload[2] / completed);
+        out += ", average response "; appendNumber(out, payload[3] / completed);
+        out += ", throughput "; appendNumber(out, clock > 0 ? payload[1] * 1000 / clock : 0);
+        out += " per 1000 cycles.\n";
+        break;
+    }
+    case EVENT_CORE_REPORT:
+        out += "Core "; appendNumber(out, payload[0]);
+        out += ": busy "; appendNumber(out, payload[1]);
+        out += " of "; appendNumber(out, clock);
+        out += " cycles ("; appendNumber(out, clock > 0 ? payload[1] * 100 / clock : 0);
+        out += "%), "; appendNumber(out, payload[2]);
+        out += " dispatches, "; appendNumber(out, payload[3]);
+        out += " steals, "; appendNumber(out, payload[4]);
+        out += " migrations.\n";
+        break;
+    case EVENT_PROCESS_RELOCATED:
+        out += "Process "; appendNumber(out, processID);
+        out += " segment "; appendNumber(out, payload[0]);
+        out += " relocated from address "; appendNumber(out, payload[1]);
+        out += " to "; appendNumber(out, payload[2]);
+        out += " ("; appendNumber(out, payload[3]);
+        out += " words).\n";
+        break;
+    case EVENT_COMPACTION_REPORT:
+        out += "Compaction: "; appendNumber(out, payload[0]);
+        out += " relocations, "; appendNumber(out, payload[1]);
+        out += " words moved.\n";
+        break;
+    case EVENT_MEMORY_DUMP:
+        out += "Memory dump at clock "; appendNumber(out, clock);
+        out += " ("; appendNumber(out, payload[0]);
+        out += " words):\n";
+        break;
+    case EVENT_MEMORY_REGION:
+        out += "Block "; appendNumber(out, payload[0]);
+        out += "-"; appendNumber(out, payload[1]);
+        if (processID == -1)
+        {
+            out += ": free";
+        }
+        else if (processID == LLONG_MIN)
+        {
+            out += ": reserved for compaction";
+        }
+        else if (processID == LLONG_MIN + 1)
+        {
+            out += ": shared page left by its owner";
+        }
+        else
+        {
+            out += ": process "; appendNumber(out, processID);
+            out += ", segment "; appendNumber(out, payload[2]);
+        }
+        out += "\n";
+        break;
+    case EVENT_MEMORY_RUN:
+        appendNumber(out, payload[0]);
+        if (payload[1] != payload[0])
+        {
+            out += "-"; appendNumber(out, payload[1]);
+        }
+        out += " : "; appendNumber(out, payload[2]);
+        out += "\n";
+        break;
+    case EVENT_JOB_BACKFILLED:
+        out += "Process "; appendNumber(out, processID);
+        out += " backfilled ahead of Process "; appendNumber(out, payload[0]);
+        out += ".\n";
+        break;
+    case EVENT_MEMORY_RESERVED:
+        out += "Memory reserved for Process "; appendNumber(out, processID);
+        out += " after waiting "; appendNumber(out, payload[0]);
+        out += " cycles, backfilling paused.\n";
+        break;
+    case EVENT_BACKFILL_REPORT:
+        out += "Backfill: "; appendNumber(out, payload[0]);
+        out += " jobs loaded ahead of the queue, "; appendNumber(out, payload[1]);
+        out += " reservations.\n";
+        break;
+    case EVENT_PAGE_FAULT:
+        out += "Process "; appendNumber(out, processID);
+        out += " page fault on page "; appendNumber(out, payload[0]);
+        out += ".\n";
+        break;
+    case EVENT_PAGE_EVICTED:
+        out += "Process "; appendNumber(out, processID);
+        out += " page "; appendNumber(out, payload[0]);
+        out += " evicted from frame at address "; appendNumber(out, payload[1]);
+        out += ".\n";
+        break;
+    case EVENT_PAGING_REPORT:
+        out += "Paging (";
+        out += payload[0] >= 0 && payload[0] < NUM_REPLACEMENT_POLICIES ? replacementNames[payload[0]] : "?";
+        out += ", "; appendNumber(out, payload[1]);
+        out += "-word pages): "; appendNumber(out, payload[2]);
+        out += " references, "; appendNumber(out, payload[3]);
+        out += " faults ("; appendNumber(out, payload[2] > 0 ? payload[3] * 1000 / payload[2] : 0);
+        out += " per 1000 references), "; appendNumber(out, payload[4]);
+        out += " swap-ins, "; appendNumber(out, payload[5]);
+        out += " swap-outs, "; appendNumber(out, payload[6]);
+        out += " evictions, "; appendNumber(out, payload[7]);
+        out += " cycles stalled.\n";
+        break;
+    case EVENT_FORKED:
+        out += "Process "; appendNumber(out, processID);
+        out += " forked Process "; appendNumber(out, payload[0]);
+        out += ".\n";
+        break;
+    case EVENT_FORK_FAILED:
+        out += "Error: Process "; appendNumber(out, processID);
+        out += " could not fork Process "; appendNumber(out, payload[0]);
+        out += ".\n";
+        break;
+    case EVENT_COW_FAULT:
+        out += "Process "; appendNumber(out, processID);
+        out += " copy-on-write fault on page "; appendNumber(out, payload[0]);
+        out += ".\n";
+        break;
+    case EVENT_FORK_REPORT:
+        out += "Fork: "; appendNumber(out, payload[0]);
+        out += " forks, "; appendNumber(out, payload[1]);
+        out += " failed, "; appendNumber(out, payload[2]);
+        out += " copy-on-write faults ("; appendNumber(out, payload[3]);
+        out += " words copied), at most "; appendNumber(out, payload[4]);
+        out += " words saved by sharing.\n";
+        break;
+    case EVENT_FILLED:
+        out += "filled\n";
+        break;
+    case EVENT_COPIED:
+        out += "copied\n";
+        break;
+    case EVENT_SUMMED:
+        out += "summed\n";
+        break;
+    case EVENT_BULK_ERROR:
+        out += "bulk error!\n";
+        break;
+    case EVENT_BULK_REPORT:
+        out += "Bulk memory: "; appendNumber(out, payload[0]);
+        out += " instructions covering "; appendNumber(out, payload[1]);
+        out += " words in "; appendNumber(out, payload[2]);
+        out += " cycles.\n";
+        break;
+    case EVENT_MEMORY_COALESCED:
+        out += "Memory coalesced. Process "; appendNumber(out, processID);
+        out += " can now be loaded.\n";
+        break;
+    case EVENT_JOB_WAITING:
+        out += "Process "; appendNumber(out, processID);
+        out += " waiting in NewJobQueue due to insufficient memory.\n";
+        break;
+    }
+}
+
+void appendBinary(string &out, const void *data, size_t size)
+{
+    out.append((const char *)data, size);
+}
+
+// Function to render a buffer of binary event records as text
+void renderRecords(const string &records, string &out)
+{
+    const char *cursor = records.data();
+    const char *end = cursor + records.size();
+    long long clock, processID;
+    unsigned short header[2];
+    long long payload[16];
+    while (cursor < end)
+    {
+        memcpy(&clock, cursor, sizeof(clock));
+        memcpy(&processID, cursor + sizeof(clock), sizeof(processID));
+        memcpy(header, cursor + sizeof(clock) + sizeof(processID), sizeof(header));
+        cursor += sizeof(clock) + sizeof(processID) + sizeof(header);
+        memcpy(payload, cursor, header[1] * sizeof(long long));
+        cursor += header[1] * sizeof(long long);
+        renderEvent(out, header[0], clock, processID, payload);
+    }
+}
+
+// Writer thread of an event log
+// The simulating thread records binary events and hands each full buffer
+// over; the writer renders it (unless the log is binary) and writes it.
+// Buffers are written one at a time in the order they were handed over, so
+// the output is the same as when the simulating thread renders it itself.
+// Two buffers alternate: one fills while the other is rendered
+struct logWriter
+{
+    thread worker;
+    mutex lock;
+    condition_variable changed;
+    string handed;      // records being rendered and written
+    bool busy = false;  // handed has not been written yet
+    bool stopping = false;
+    bool binary;
+    FILE *out;
+};
+
+void runLogWriter(logWriter &writer)
+{
+    string text;
+    unique_lock<mutex> guard(writer.lock);
+    for (;;)
+    {
+        writer.changed.wait(guard, [&] { return writer.busy || writer.stopping; });
+        if (!writer.busy)
+        {
+            return;
+        }
+        guard.unlock();
+        if (writer.binary)
+        {
+            fwrite(writer.handed.data(), 1, writer.handed.size(), writer.out);
+        }
+        else
+        {
+            text.clear();
+            renderRecords(writer.handed, text);
+            fwrite(text.data(), 1, text.size(), writer.out);
+        }
+        writer.handed.clear();
+        guard.lock();
+        writer.busy = false;
+        writer.changed.notify_all();
+    }
+}
+
+// Function to hand the buffered records of a log to its writer thread
+// It waits for the previous buffer to be written first, and with wait set
+// also for this one
+void handOffLog(eventLog &log, bool wait)
+{
+    logWriter &writer = *log.writer;
+    unique_lock<mutex> guard(writer.lock);
+    writer.changed.wait(guard, [&] { return !writer.busy; });
+    if (!log.buffer.empty())
+    {
+        writer.handed.swap(log.buffer);
+        writer.busy = true;
+        writer.changed.notify_all();
+    }
+    if (wait)
+    {
+        writer.changed.wait(guard, [&] { return !writer.busy; });
+    }
+}
+
+// Function to start a writer thread for a log
+// Text already in the buffer of a text log is written out first
+void startLogWriter(eventLog &log)
+{
+    if (!log.binary && !log.buffer.empty())
+    {
+        fwrite(log.buffer.data(), 1, log.buffer.size(), log.out);
+        log.buffer.clear();
+    }
+    log.writer = new logWriter();
+    log.writer->binary = log.binary;
+    log.writer->out = log.out;
+    log.writer->handed.reserve(log.buffer.capacity());
+    log.writer->worker = thread(runLogWriter, ref(*log.writer));
+}
+
+// Function to write out what is left in a log and stop its writer thread
+void stopLogWriter(eventLog &log)
+{
+    if (log.writer == NULL)
+    {
+        return;
+    }
+    handOffLog(log, true);
+    {
+        lock_guard<mutex> guard(log.writer->lock);
+        log.writer->stopping = true;
+        log.writer->changed.notify_all();
+    }
+    log.writer->worker.join();
+    delete log.writer;
+    log.writer = NULL;
+}
+
+void flushLog()
+{
+    if (activeLog->writer != NULL)
+    {
+        handOffLog(*activeLog, true);
+    }
+    else if (!activeLog->buffer.empty())
+    {
+        fwrite(activeLog->buffer.data(), 1, activeLog->buffer.size(), activeLog->out);
+        activeLog->buffer.clear();
+    }
+    fflush(activeLog->out);
+}
+
+// Function to record an event
+// Events above the configured verbosity level cost one comparison
+inline void logEvent(int type, long long clock, long long processID, initializer_list<long long> payload = {})
+{
+    if (eventLevels[type] > activeLog->level)
+    {
+        return;
+    }
+    if (activeLog->binary || activeLog->writer != NULL)
+    { // the writer thread renders text logs from the records
+        unsigned short header[2] = {(unsigned short)type, (unsigned short)payload.size()};
+        appendBinary(activeLog->buffer, &clock, sizeof(clock));
+        appendBinary(activeLog->buffer, &processID, sizeof(processID));
+        appendBinary(activeLog->buffer, header, sizeof(header));
+        appendBinary(activeLog->buffer, payload.begin(), payload.size() * sizeof(long long));
+    }
+    else
+    {
+        renderEvent(activeLog->buffer, type, clock, processID, payload.begin());
+    }
+    if (activeLog->buffer.size() >= LOG_FLUSH_SIZE)
+    {
+        if (activeLog->writer != NULL)
+        {
+            handOffLog(*activeLog, false);
+            return;
+        }
+        flushLog();
+    }
+}
+
+// Function to render a binary log file as text on stdout
+// Only events up to the given verbosity level are rendered
+// Returns false if the file cannot be read or is not a binary event log
+bool decodeLog(const string &path, int level)
+{
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in == NULL)
+    {
+        cerr << "Error: cannot open log file " << path << "." << endl;
+        return false;
+    }
+    char magic[sizeof(LOG_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0)
+    {
+        cerr << "Error: " << path << " is not a binary event log." << endl;
+        fclose(in);
+        return false;
+    }
+    eventLog log;
+    log.level = level;
+    activeLog = &log;
+    long long clock, processID;
+    unsigned short header[2];
+    long long payload[16];
+    while (fread(&clock, sizeof(clock), 1, in) == 1 && fread(&processID, sizeof(processID), 1, in) == 1 &&
+           fread(header, sizeof(header), 1, in) == 1)
+    {
+        if (header[0] >= NUM_EVENT_TYPES || header[1] > 16 ||
+            fread(payload, sizeof(long long), header[1], in) != header[1])
+        {
+            cerr << "Error: corrupt record in " << path << "." << endl;
+            break;
+        }
+        if (eventLevels[header[0]] <= level)
+        {
+            renderEvent(log.buffer, header[0], clock, processID, payload);
+        }
+        if (log.buffer.size() >= LOG_FLUSH_SIZE)
+        {
+            flushLog();
+        }
+    }
+    flushLog();
+    activeLog = NULL;
+    fclose(in);
+    return true;
+}
+
 struct PCB
 {
-    int processID;
+    long long processID;
     int state; // 0 = new, 1 = ready, 2 = running, 3 = terminated, 4 = IOWaiting
     int programCounter;
     int instructionBase;
@@ -22,6 +711,22 @@ struct PCB
     int instructionSize;
     int startTime;
     int endTime;
+
+    // Jobs are moved, never copied, so a job's logical memory is only ever
+    // held in one place and its buffer can be reused once the job is loaded
+    PCB() = default;
+    PCB(PCB &&) = default;
+    PCB &operator=(PCB &&) = default;
+    PCB(const PCB &) = delete;
+    PCB &operator=(const PCB &) = delete;
+};
+
+// Priority queue whose entries can be patched in place, as long as the
+// fields the ordering depends on are left unchanged
+template <typename T, typename Compare>
+struct patchableHeap : priority_queue<T, vector<T>, Compare>
+{
+    vector<T> &entries() { return this->c; }
 };
 
 struct IOWaitEntry
@@ -29,15 +734,75 @@ struct IOWaitEntry
     int baseAddress;
     int entryTime;
     int ioCycles;
+    long long sequence; // order of entry, completions due together are handled in this order
+};
+
+// Heap order for IO waits: the entry completing first is on top
+struct laterIOCompletion
+{
+    bool operator()(const IOWaitEntry &a, const IOWaitEntry &b) const
+    {
+        long long aDue = (long long)a.entryTime + a.ioCycles;
+        long long bDue = (long long)b.entryTime + b.ioCycles;
+        if (aDue != bDue)
+        {
+            return aDue > bDue;
+        }
+        return a.sequence > b.sequence;
+    }
+};
+
+// IO waiting queue kept as a min-heap on completion time (entryTime + ioCycles)
+struct ioTimerQueue
+{
+    patchableHeap<IOWaitEntry, laterIOCompletion> waiting;
+    vector<IOWaitEntry> completed; // scratch list reused by checkIOWaitingQueue
+    long long nextSequence = 0;
+
+    bool empty() const { return waiting.empty(); }
+    size_t size() const { return waiting.size(); }
+
+    void push(int baseAddress, int entryTime, int ioCycles)
+    {
+        waiting.push({baseAddress, entryTime, ioCycles, nextSequence++});
+    }
+
+    // Clock time at which the earliest waiting IO completes
+    long long nextCompletion() const
+    {
+        return (long long)waiting.top().entryTime + waiting.top().ioCycles;
+    }
+
+    // Function to follow a process whose PCB moved
+    void relocate(int from, int to)
+    {
+        for (IOWaitEntry &entry : waiting.entries())
+        {
+            if (entry.baseAddress == from)
+            {
+                entry.baseAddress = to;
+            }
+        }
+    }
 };
 
 struct memoryBlock
 {
-    int processID = -1;
+    long long processID = -1;
     int startingAddress;
     int size;
+    int prevBlock = -1; // physical neighbours, these act as the block's boundary tags
+    int nextBlock = -1;
+    int prevFree = -1;  // links within the size class free list (free blocks only)
+    int nextFree = -1;
+    int treeLeft = -1;  // children in the address ordered tree of free blocks (free blocks only)
+    int treeRight = -1;
+    int treeLargest = 0; // size of the largest free block in this block's subtree
+    unsigned int treePriority = 0; // heap order of the tree, random
+    bool coalescePending = false;  // in the allocator's uncoalesced list
+    int sharers = 0;    // processes mapping the block as a copy-on-write page, 0 if it is not one
 
-    memoryBlock(int processID, int startingAddress, int size)
+    memoryBlock(long long processID, int startingAddress, int size)
     {
         this->processID = processID;
         this->startingAddress = startingAddress;
@@ -45,124 +810,719 @@ struct memoryBlock
     }
 };
 
-// Function to check if there is a sufficient memory block available for the job required size
-bool hasSufficientMemoryBlock(list<memoryBlock>& memoryList, int requiredSize) {
+// Free blocks are kept in segregated size classes: sizes below 8 get one class each,
+// every larger power of two is split into 8 linear sub-classes. They are also
+// kept in a treap ordered by address, where each node knows the largest free
+// block below it, so the lowest addressed block that fits is found in O(log n)
+const int SMALL_BLOCK_CLASSES = 8;
+const int SUB_CLASS_BITS = 3;
+const int NUM_SIZE_CLASSES = SMALL_BLOCK_CLASSES + (31 - SUB_CLASS_BITS) * (1 << SUB_CLASS_BITS);
+const int CLASS_MAP_WORDS = (NUM_SIZE_CLASSES + 63) / 64;
 
-    for (auto block : memoryList) {
-        if (block.processID == -1 && block.size >= requiredSize) {
-            return true;
-        }
+struct pagingState;
+struct sharingState;
+
+struct memoryAllocator
+{
+    vector<memoryBlock> blocks;      // block pool, blocks refer to each other by index
+    vector<int> unusedBlocks;        // pool slots released when blocks merge
+    int firstBlock = -1;             // lowest addressed block
+    int freeLists[NUM_SIZE_CLASSES]; // head of each size class free list
+    unsigned long long nonEmptyClasses[CLASS_MAP_WORDS];
+    int freeTree = -1;               // root of the address ordered tree of free blocks
+    vector<int> uncoalesced;         // blocks freed next to a free block since the last coalescing
+    bool segmented = false;          // jobs that do not fit in one block may be split into segments
+    pagingState *paging = NULL;      // set in paged mode, where blocks are page frames and PCBs
+    sharingState *sharing = NULL;    // pages of processes that fork, shared copy-on-write
+    long long freeWords = 0;         // total size of the blocks in the free lists
+};
+
+// Function to map a block size to its size class
+int sizeClass(int size)
+{
+    if (size < SMALL_BLOCK_CLASSES)
+    {
+        return size;
     }
-    return false;
+    int topBit = 31 - __builtin_clz(size);
+    int subClass = (size >> (topBit - SUB_CLASS_BITS)) & ((1 << SUB_CLASS_BITS) - 1);
+    return SMALL_BLOCK_CLASSES + ((topBit - SUB_CLASS_BITS) << SUB_CLASS_BITS) + subClass;
 }
 
-// Function to coalesce adjacent free memory blocks
-// This function merges adjacent free blocks into a single larger block
-// and returns true if any coalescing was done
-bool coalesce(list<memoryBlock> &memoryList) {
-    if (memoryList.size() <= 1)
-        return false;
+// Function to recompute the largest free block below a tree node
+void updateFreeTree(memoryAllocator &memoryList, int node)
+{
+    memoryBlock &block = memoryList.blocks[node];
+    block.treeLargest = block.size;
+    if (block.treeLeft != -1)
+    {
+        block.treeLargest = max(block.treeLargest, memoryList.blocks[block.treeLeft].treeLargest);
+    }
+    if (block.treeRight != -1)
+    {
+        block.treeLargest = max(block.treeLargest, memoryList.blocks[block.treeRight].treeLargest);
+    }
+}
 
-    bool coalesced = false;
-    bool merged;
+// Function to split a tree of free blocks into the blocks below an address and the rest
+void splitFreeTree(memoryAllocator &memoryList, int node, int address, int &below, int &rest)
+{
+    if (node == -1)
+    {
+        below = -1;
+        rest = -1;
+        return;
+    }
+    memoryBlock &block = memoryList.blocks[node];
+    if (block.startingAddress < address)
+    {
+        splitFreeTree(memoryList, block.treeRight, address, block.treeRight, rest);
+        below = node;
+    }
+    else
+    {
+        splitFreeTree(memoryList, block.treeLeft, address, below, block.treeLeft);
+        rest = node;
+    }
+    updateFreeTree(memoryList, node);
+}
 
-    do {
-        merged = false;
-        auto current = memoryList.begin();
-        while (current != memoryList.end() && std::next(current) != memoryList.end()) {
-            auto nextBlock = std::next(current);
-            if (current->processID == -1 && nextBlock->processID == -1 &&
-                current->startingAddress + current->size == nextBlock->startingAddress) {
-                current->size += nextBlock->size;
-                memoryList.erase(nextBlock);
-                coalesced = true;
-                merged = true;
-            } else {
-                ++current;
-            }
-        }
-    } while (merged);
+// Function to join two trees of free blocks, every block in low lies below every block in high
+// Returns the root of the joined tree
+int mergeFreeTrees(memoryAllocator &memoryList, int low, int high)
+{
+    if (low == -1 || high == -1)
+    {
+        return low == -1 ? high : low;
+    }
+    if (memoryList.blocks[low].treePriority > memoryList.blocks[high].treePriority)
+    {
+        int right = mergeFreeTrees(memoryList, memoryList.blocks[low].treeRight, high);
+        memoryList.blocks[low].treeRight = right;
+        updateFreeTree(memoryList, low);
+        return low;
+    }
+    int left = mergeFreeTrees(memoryList, low, memoryList.blocks[high].treeLeft);
+    memoryList.blocks[high].treeLeft = left;
+    updateFreeTree(memoryList, high);
+    return high;
+}
 
-    return coalesced;
+// Function to add a free block to the tree of free blocks
+// On the way down every subtree the block joins may get a larger largest
+// block; where the block's priority puts it, the subtree is split around it
+void insertFreeTree(memoryAllocator &memoryList, int index)
+{
+    memoryBlock &block = memoryList.blocks[index];
+    int *link = &memoryList.freeTree;
+    while (*link != -1 && memoryList.blocks[*link].treePriority >= block.treePriority)
+    {
+        memoryBlock &node = memoryList.blocks[*link];
+        node.treeLargest = max(node.treeLargest, block.size);
+        link = block.startingAddress < node.startingAddress ? &node.treeLeft : &node.treeRight;
+    }
+    splitFreeTree(memoryList, *link, block.startingAddress, block.treeLeft, block.treeRight);
+    updateFreeTree(memoryList, index);
+    *link = index;
 }
-// Function to print the current state of the memory list
-// This function is used for debugging purposes
-void printList(const list<memoryBlock> &memoryList)
+
+// Function to take the free block at the given address out of the tree below node,
+// or to put the replacement block in its place; the replacement must lie between
+// the same free neighbours and takes over the node's children and priority, the
+// two blocks swap priorities so that they stay spread out
+// Returns the new root of that subtree
+int replaceFreeTree(memoryAllocator &memoryList, int node, int address, int replacement)
 {
-    cout << "Memory List State:" << endl;
-    for (auto it = memoryList.begin(); it != memoryList.end(); ++it)
+    memoryBlock &block = memoryList.blocks[node];
+    if (address < block.startingAddress)
     {
-        cout << "PID: " << it->processID << ", Start: " << it->startingAddress
-             << ", Size: " << it->size << endl;
+        block.treeLeft = replaceFreeTree(memoryList, block.treeLeft, address, replacement);
     }
-    cout << endl;
+    else if (address > block.startingAddress)
+    {
+        block.treeRight = replaceFreeTree(memoryList, block.treeRight, address, replacement);
+    }
+    else if (replacement == -1)
+    {
+        return mergeFreeTrees(memoryList, block.treeLeft, block.treeRight);
+    }
+    else
+    {
+        memoryBlock &substitute = memoryList.blocks[replacement];
+        substitute.treeLeft = block.treeLeft;
+        substitute.treeRight = block.treeRight;
+        swap(substitute.treePriority, block.treePriority);
+        node = replacement;
+    }
+    updateFreeTree(memoryList, node);
+    return node;
 }
 
+void addToSizeClass(memoryAllocator &memoryList, int index)
+{
+    memoryBlock &block = memoryList.blocks[index];
+    int sc = sizeClass(block.size);
+    block.prevFree = -1;
+    block.nextFree = memoryList.freeLists[sc];
+    if (block.nextFree != -1)
+    {
+        memoryList.blocks[block.nextFree].prevFree = index;
+    }
+    memoryList.freeLists[sc] = index;
+    memoryList.nonEmptyClasses[sc / 64] |= 1ULL << (sc % 64);
+    memoryList.freeWords += block.size;
+}
 
-// Function to free a block of memory
-// and update the memory list
-void freeBlock(int processID, list<memoryBlock> &memoryList, int *mainMemory)
+void removeFromSizeClass(memoryAllocator &memoryList, int index)
 {
-    bool found = false;
-    for (auto it = memoryList.begin(); it != memoryList.end(); ++it)
+    memoryBlock &block = memoryList.blocks[index];
+    int sc = sizeClass(block.size);
+    if (block.prevFree != -1)
+    {
+        memoryList.blocks[block.prevFree].nextFree = block.nextFree;
+    }
+    else
     {
-        if (it->processID == processID)
+        memoryList.freeLists[sc] = block.nextFree;
+        if (block.nextFree == -1)
         {
-            found = true;
-            cout << "Process " << processID << " terminated and released memory from "
-                 << it->startingAddress << " to "
-                 << (it->startingAddress + it->size - 1) << "." << endl;
+            memoryList.nonEmptyClasses[sc / 64] &= ~(1ULL << (sc % 64));
+        }
+    }
+    if (block.nextFree != -1)
+    {
+        memoryList.blocks[block.nextFree].prevFree = block.prevFree;
+    }
+    block.prevFree = -1;
+    block.nextFree = -1;
+    memoryList.freeWords -= block.size;
+}
 
-            for (int i = it->startingAddress; i < it->startingAddress + it->size; i++)
-            {
-                mainMemory[i] = -1;
-            }
+void insertFreeBlock(memoryAllocator &memoryList, int index)
+{
+    addToSizeClass(memoryList, index);
+    insertFreeTree(memoryList, index);
+}
 
-            it->processID = -1;
-            //coalesce(memoryList);
-           // printList(memoryList); // Debug output
-            break;
-        }
+void removeFreeBlock(memoryAllocator &memoryList, int index)
+{
+    removeFromSizeClass(memoryList, index);
+    memoryList.freeTree =
+        replaceFreeTree(memoryList, memoryList.freeTree, memoryList.blocks[index].startingAddress, -1);
+}
+
+unsigned long long hashKey(long long key);
+
+// Function to take a block slot from the pool, reusing slots of merged blocks
+int newBlock(memoryAllocator &memoryList, long long processID, int startingAddress, int size)
+{
+    int index;
+    if (!memoryList.unusedBlocks.empty())
+    {
+        index = memoryList.unusedBlocks.back();
+        memoryList.unusedBlocks.pop_back();
+        memoryList.blocks[index] = memoryBlock(processID, startingAddress, size);
+    }
+    else
+    {
+        index = memoryList.blocks.size();
+        memoryList.blocks.push_back(memoryBlock(processID, startingAddress, size));
+    }
+    memoryList.blocks[index].treePriority = (unsigned int)hashKey(index);
+    return index;
+}
+
+// Function to set up the allocator with a single free block of size maxMemory
+void initMemoryAllocator(memoryAllocator &memoryList, int maxMemory)
+{
+    memoryList.blocks.clear();
+    memoryList.unusedBlocks.clear();
+    for (int i = 0; i < NUM_SIZE_CLASSES; i++)
+    {
+        memoryList.freeLists[i] = -1;
     }
-    if (!found)
+    for (int i = 0; i < CLASS_MAP_WORDS; i++)
     {
-        cout << "Error: Process " << processID << " not found in memory list for freeing." << endl;
+        memoryList.nonEmptyClasses[i] = 0;
     }
+    memoryList.freeWords = 0;
+    memoryList.freeTree = -1;
+    memoryList.uncoalesced.clear();
+    memoryList.firstBlock = newBlock(memoryList, -1, 0, maxMemory);
+    insertFreeBlock(memoryList, memoryList.firstBlock);
 }
-void checkIOWaitingQueue(queue<IOWaitEntry> &ioWaitQueue, int &globalClock, queue<int> &readyQueue, int *mainMemory)
+
+// Function to find the lowest addressed free block of at least the required size
+// The tree is descended towards the lowest address whose subtree still holds a
+// large enough block, so this is the block a first-fit scan of the list would find
+// Returns the block index or -1 if no free block is large enough
+int findFreeBlock(const memoryAllocator &memoryList, int requiredSize)
 {
-    queue<IOWaitEntry> temp;
-    while (!ioWaitQueue.empty())
+    if (requiredSize <= 0)
     {
-        IOWaitEntry entry = ioWaitQueue.front();
-        ioWaitQueue.pop();
-        if (globalClock - entry.entryTime >= entry.ioCycles)
+        requiredSize = 1;
+    }
+    int node = memoryList.freeTree;
+    if (node == -1 || memoryList.blocks[node].treeLargest < requiredSize)
+    {
+        return -1;
+    }
+    while (true)
+    {
+        const memoryBlock &block = memoryList.blocks[node];
+        if (block.treeLeft != -1 && memoryList.blocks[block.treeLeft].treeLargest >= requiredSize)
         {
-            // globalClock += entry.ioCycles; // Update global clock
-            int base = entry.baseAddress;
-            int processID = mainMemory[base];
-            cout << "print" << endl;
-            mainMemory[base + 1] = 1; // Ready
-            readyQueue.push(base);
-            cout << "Process " << processID << " completed I/O and is moved to the ReadyQueue." << endl;
+            node = block.treeLeft;
+        }
+        else if (block.size >= requiredSize)
+        {
+            return node;
         }
         else
         {
-            temp.push(entry);
+            node = block.treeRight;
         }
     }
-    ioWaitQueue = temp;
 }
 
-void copyProcessToMemory(int* processLogicalMemory,int totalLogicalSize, int* PCB, int* mainMemory){
-
-        int segmentTableSize = PCB[0];
-        int numSegments = segmentTableSize / 2;
-        
-        int logicalIndex = 0;
+// Function to check if there is a sufficient memory block available for the job required size
+bool hasSufficientMemoryBlock(const memoryAllocator &memoryList, int requiredSize)
+{
+    return findFreeBlock(memoryList, requiredSize) != -1;
+}
 
-        for(int i = 0; i < numSegments; i++){
-            int start = PCB[1 + i * 2];
+// Function to cut a block that is not in the free lists in two
+// The block keeps its first size words, the rest becomes a new block with the same owner
+// Returns the index of the new block
+int splitBlock(memoryAllocator &memoryList, int index, int size)
+{
+    const memoryBlock &original = memoryList.blocks[index];
+    int rest = newBlock(memoryList, original.processID, original.startingAddress + size, original.size - size);
+    memoryBlock &block = memoryList.blocks[index];
+    memoryBlock &restBlock = memoryList.blocks[rest];
+    restBlock.prevBlock = index;
+    restBlock.nextBlock = block.nextBlock;
+    if (block.nextBlock != -1)
+    {
+        memoryList.blocks[block.nextBlock].prevBlock = rest;
+    }
+    block.nextBlock = rest;
+    block.size = size;
+    return rest;
+}
+
+// Function to give a free block to a process
+// The block is split if it is larger than needed, the process keeps the lower part
+void claimBlock(memoryAllocator &memoryList, int index, long long processID, int size)
+{
+    removeFromSizeClass(memoryList, index);
+    int address = memoryList.blocks[index].startingAddress;
+    if (memoryList.blocks[index].size <= size)
+    {
+        memoryList.freeTree = replaceFreeTree(memoryList, memoryList.freeTree, address, -1);
+    }
+    else
+    { // the rest takes the block's place in the tree
+        int rest = splitBlock(memoryList, index, size);
+        addToSizeClass(memoryList, rest);
+        memoryList.freeTree = replaceFreeTree(memoryList, memoryList.freeTree, address, rest);
+        int next = memoryList.blocks[rest].nextBlock;
+        if (next != -1 && memoryList.blocks[next].processID == -1)
+        { // the block's free neighbour is the rest's neighbour now
+            memoryList.blocks[rest].coalescePending = true;
+            memoryList.uncoalesced.push_back(rest);
+        }
+    }
+    memoryList.blocks[index].processID = processID;
+}
+
+// Function to allocate a block of the given size to a process
+// Returns the block index or -1 if no free block is large enough
+int allocateBlock(memoryAllocator &memoryList, long long processID, int size)
+{
+    int index = findFreeBlock(memoryList, size);
+    if (index == -1)
+    {
+        return -1;
+    }
+    claimBlock(memoryList, index, processID, size);
+    return index;
+}
+
+// Function to collect up to maxCount free blocks, taking the highest size classes first
+// The largest block found is moved to the front
+// Returns the number of blocks collected
+int largestFreeBlocks(const memoryAllocator &memoryList, int *indices, int maxCount)
+{
+    int count = 0;
+    for (int sc = NUM_SIZE_CLASSES - 1; sc >= 0 && count < maxCount; sc--)
+    {
+        if ((memoryList.nonEmptyClasses[sc / 64] & (1ULL << (sc % 64))) == 0)
+        {
+            continue;
+        }
+        for (int index = memoryList.freeLists[sc]; index != -1 && count < maxCount;
+             index = memoryList.blocks[index].nextFree)
+        {
+            indices[count++] = index;
+            if (memoryList.blocks[index].size > memoryList.blocks[indices[0]].size)
+            {
+                swap(indices[0], indices[count - 1]);
+            }
+        }
+    }
+    return count;
+}
+
+// Function to get the size of the largest free block, 0 if memory is full
+int largestFreeSize(const memoryAllocator &memoryList)
+{
+    return memoryList.freeTree == -1 ? 0 : memoryList.blocks[memoryList.freeTree].treeLargest;
+}
+
+// Function to merge a free block into the free block physically before it
+// The later block's pool slot is released, its size of 0 marks it as unused
+void mergeWithPrevious(memoryAllocator &memoryList, int index)
+{
+    memoryBlock &block = memoryList.blocks[index];
+    memoryBlock &previous = memoryList.blocks[block.prevBlock];
+    previous.size += block.size;
+    previous.nextBlock = block.nextBlock;
+    if (block.nextBlock != -1)
+    {
+        memoryList.blocks[block.nextBlock].prevBlock = block.prevBlock;
+    }
+    block.size = 0;
+    memoryList.unusedBlocks.push_back(index);
+}
+
+// Function to remember a free block that has a free physical neighbour
+// Every such pair then has a member in the uncoalesced list, so coalescing
+// only has to look at the blocks in it
+void noteFreeNeighbours(memoryAllocator &memoryList, int index)
+{
+    memoryBlock &block = memoryList.blocks[index];
+    if (!block.coalescePending &&
+        ((block.prevBlock != -1 && memoryList.blocks[block.prevBlock].processID == -1) ||
+         (block.nextBlock != -1 && memoryList.blocks[block.nextBlock].processID == -1)))
+    {
+        block.coalescePending = true;
+        memoryList.uncoalesced.push_back(index);
+    }
+}
+
+// Function to return a block to the free lists
+// Like the list allocator, a freed block is not merged with free neighbours
+// until coalesceFreeBlocks is called, which is when a job does not fit
+void releaseBlock(memoryAllocator &memoryList, int index)
+{
+    memoryList.blocks[index].processID = -1;
+    memoryList.blocks[index].sharers = 0;
+    insertFreeBlock(memoryList, index);
+    noteFreeNeighbours(memoryList, index);
+}
+
+// Function to merge adjacent free blocks into single larger blocks
+// Each run of free blocks is found from a block of it in the uncoalesced
+// list and merged into its lowest addressed block, using the boundary tags
+// Returns true if any blocks were merged
+bool coalesceFreeBlocks(memoryAllocator &memoryList)
+{
+    bool coalesced = false;
+    for (int index : memoryList.uncoalesced)
+    {
+        memoryList.blocks[index].coalescePending = false;
+        if (memoryList.blocks[index].size == 0 || memoryList.blocks[index].processID != -1)
+        {
+            continue; // merged away already, or allocated again
+        }
+        while (memoryList.blocks[index].prevBlock != -1 &&
+               memoryList.blocks[memoryList.blocks[index].prevBlock].processID == -1)
+        {
+            index = memoryList.blocks[index].prevBlock;
+        }
+        int next = memoryList.blocks[index].nextBlock;
+        if (next == -1 || memoryList.blocks[next].processID != -1)
+        {
+            continue;
+        }
+        removeFromSizeClass(memoryList, index);
+        while (next != -1 && memoryList.blocks[next].processID == -1)
+        {
+            removeFreeBlock(memoryList, next);
+            mergeWithPrevious(memoryList, next);
+            next = memoryList.blocks[index].nextBlock;
+        }
+        addToSizeClass(memoryList, index);
+        memoryList.freeTree =
+            replaceFreeTree(memoryList, memoryList.freeTree, memoryList.blocks[index].startingAddress, index);
+        coalesced = true;
+    }
+    memoryList.uncoalesced.clear();
+    return coalesced;
+}
+
+// Function to find a free block of at least the required size, coalescing
+// free blocks first when none is large enough as they are
+// Returns the block index or -1 if no free block is large enough
+int findFreeBlockCoalescing(memoryAllocator &memoryList, int requiredSize)
+{
+    int index = findFreeBlock(memoryList, requiredSize);
+    if (index == -1 && coalesceFreeBlocks(memoryList))
+    {
+        index = findFreeBlock(memoryList, requiredSize);
+    }
+    return index;
+}
+
+// Function to print the current state of the memory list
+// This function is used for debugging purposes
+void printList(const memoryAllocator &memoryList)
+{
+    flushLog();
+    cout << "Memory List State:" << endl;
+    for (int index = memoryList.firstBlock; index != -1; index = memoryList.blocks[index].nextBlock)
+    {
+        const memoryBlock &block = memoryList.blocks[index];
+        cout << "PID: " << block.processID << ", Start: " << block.startingAddress
+             << ", Size: " << block.size << endl;
+    }
+    cout << endl;
+}
+
+
+// Open-addressing hash index from a 64-bit key to a process table slot
+// Uses linear probing; erasing shifts later entries back, so no tombstones are needed
+struct hashIndex
+{
+    vector<long long> keys;
+    vector<int> values; // -1 marks an empty bucket
+    int count = 0;
+};
+
+// Function to mix a key into a well spread bucket hash (splitmix64 finalizer)
+unsigned long long hashKey(long long key)
+{
+    unsigned long long x = (unsigned long long)key;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Function to look up a key, returns its value or -1 if it is not present
+int hashIndexFind(const hashIndex &index, long long key)
+{
+    if (index.count == 0)
+    {
+        return -1;
+    }
+    size_t mask = index.keys.size() - 1;
+    for (size_t bucket = hashKey(key) & mask; index.values[bucket] != -1; bucket = (bucket + 1) & mask)
+    {
+        if (index.keys[bucket] == key)
+        {
+            return index.values[bucket];
+        }
+    }
+    return -1;
+}
+
+void hashIndexInsert(hashIndex &index, long long key, int value);
+
+// Function to double the bucket count once the index is 70% full
+void hashIndexGrow(hashIndex &index)
+{
+    vector<long long> oldKeys;
+    vector<int> oldValues;
+    oldKeys.swap(index.keys);
+    oldValues.swap(index.values);
+    size_t capacity = oldKeys.empty() ? 16 : oldKeys.size() * 2;
+    index.keys.assign(capacity, 0);
+    index.values.assign(capacity, -1);
+    index.count = 0;
+    for (size_t i = 0; i < oldKeys.size(); i++)
+    {
+        if (oldValues[i] != -1)
+        {
+            hashIndexInsert(index, oldKeys[i], oldValues[i]);
+        }
+    }
+}
+
+// Function to insert a key or overwrite its value
+void hashIndexInsert(hashIndex &index, long long key, int value)
+{
+    if ((index.count + 1) * 10 > (long long)index.keys.size() * 7)
+    {
+        hashIndexGrow(index);
+    }
+    size_t mask = index.keys.size() - 1;
+    size_t bucket = hashKey(key) & mask;
+    while (index.values[bucket] != -1 && index.keys[bucket] != key)
+    {
+        bucket = (bucket + 1) & mask;
+    }
+    if (index.values[bucket] == -1)
+    {
+        index.count++;
+    }
+    index.keys[bucket] = key;
+    index.values[bucket] = value;
+}
+
+// Function to erase a key
+// Entries after the erased bucket are shifted back into the gap when their
+// probe sequence passes through it, keeping every key reachable
+void hashIndexErase(hashIndex &index, long long key)
+{
+    if (index.count == 0)
+    {
+        return;
+    }
+    size_t mask = index.keys.size() - 1;
+    size_t bucket = hashKey(key) & mask;
+    while (index.values[bucket] != -1 && index.keys[bucket] != key)
+    {
+        bucket = (bucket + 1) & mask;
+    }
+    if (index.values[bucket] == -1)
+    {
+        return;
+    }
+    index.count--;
+    size_t gap = bucket;
+    for (size_t next = (gap + 1) & mask; index.values[next] != -1; next = (next + 1) & mask)
+    {
+        size_t home = hashKey(index.keys[next]) & mask;
+        // Move the entry back unless its home bucket lies cyclically in (gap, next]
+        if (((next - home) & mask) >= ((next - gap) & mask))
+        {
+            index.keys[gap] = index.keys[next];
+            index.values[gap] = index.values[next];
+            gap = next;
+        }
+    }
+    index.values[gap] = -1;
+}
+
+// Segmented processes start with the PCB followed by a segment table of
+// MAX_SEGMENTS (start, length) pairs, word 0 of the table holds 2 * segment count.
+// Logical addresses are offsets into the concatenation of the segments
+const int PCB_SIZE = 10;
+const int MAX_SEGMENTS = 6;
+const int SEGMENT_TABLE_SIZE = 1 + 2 * MAX_SEGMENTS;
+const int SEGMENTED_HEADER_SIZE = PCB_SIZE + SEGMENT_TABLE_SIZE;
+
+// Word of main memory, stored complemented so that an all-zero page reads as
+// -1 (free). Main memory is an anonymous mapping: untouched pages cost
+// nothing and freed pages are handed back to the kernel, which maps them to
+// zero on the next touch, so the simulated address space can be far larger
+// than the words actually in use
+struct memoryWord
+{
+    int stored = 0;
+
+    operator int() const
+    {
+        return ~stored;
+    }
+    memoryWord &operator=(int value)
+    {
+        stored = ~value;
+        return *this;
+    }
+    memoryWord &operator+=(int delta)
+    {
+        return *this = *this + delta;
+    }
+};
+
+const size_t MEMORY_PAGE_SIZE = 4096;
+const size_t MEMORY_RELEASE_MINIMUM = 16 * MEMORY_PAGE_SIZE; // smaller ranges are cheaper to clear in place
+
+// Function to set count words of main memory starting at first back to -1
+// The whole pages of a large range are dropped instead of written
+void releaseWords(memoryWord *mainMemory, int first, int count)
+{
+    char *begin = (char *)(mainMemory + first);
+    char *end = (char *)(mainMemory + first + count);
+    char *pagesBegin = (char *)(((uintptr_t)begin + MEMORY_PAGE_SIZE - 1) & ~(uintptr_t)(MEMORY_PAGE_SIZE - 1));
+    char *pagesEnd = (char *)((uintptr_t)end & ~(uintptr_t)(MEMORY_PAGE_SIZE - 1));
+    if (pagesEnd - pagesBegin >= (ptrdiff_t)MEMORY_RELEASE_MINIMUM &&
+        madvise(pagesBegin, pagesEnd - pagesBegin, MADV_DONTNEED) == 0)
+    {
+        memset(begin, 0, pagesBegin - begin);
+        memset(pagesEnd, 0, end - pagesEnd);
+        return;
+    }
+    memset(begin, 0, end - begin);
+}
+
+// Words the bulk memory kernels handle per step. The fixed inner loop is
+// unrolled into vector instructions even at -O2, where a loop over an
+// unknown count of words is left scalar
+const int BULK_LANES = 8;
+
+// Function to set count words of main memory starting at first to value
+void fillWords(memoryWord *mainMemory, int first, int count, int value)
+{
+    memoryWord *words = mainMemory + first;
+    int i = 0;
+    for (; i + BULK_LANES <= count; i += BULK_LANES)
+    {
+        for (int lane = 0; lane < BULK_LANES; lane++)
+        {
+            words[i + lane] = value;
+        }
+    }
+    for (; i < count; i++)
+    {
+        words[i] = value;
+    }
+}
+
+// Function to copy count words of main memory from source to destination, the ranges may overlap
+void copyWords(memoryWord *mainMemory, int source, int destination, int count)
+{
+    memmove(mainMemory + destination, mainMemory + source, count * sizeof(memoryWord));
+}
+
+// Function to add up count words of main memory starting at first
+// The sum wraps around like any 32-bit register value
+int sumWords(const memoryWord *mainMemory, int first, int count)
+{
+    const memoryWord *words = mainMemory + first;
+    unsigned lanes[BULK_LANES] = {};
+    int i = 0;
+    for (; i + BULK_LANES <= count; i += BULK_LANES)
+    {
+        for (int lane = 0; lane < BULK_LANES; lane++)
+        {
+            lanes[lane] += (int)words[i + lane];
+        }
+    }
+    unsigned total = 0;
+    for (int lane = 0; lane < BULK_LANES; lane++)
+    {
+        total += lanes[lane];
+    }
+    for (; i < count; i++)
+    {
+        total += (int)words[i];
+    }
+    return (int)total;
+}
+
+// Function to copy a process image into the segments listed in its segment table
+void copyProcessToMemory(const int* processLogicalMemory,int totalLogicalSize, const int* PCB, memoryWord* mainMemory){
+
+        int segmentTableSize = PCB[0];
+        int numSegments = segmentTableSize / 2;
+        
+        int logicalIndex = 0;
+
+        for(int i = 0; i < numSegments; i++){
+            int start = PCB[1 + i * 2];
             int length = PCB[1 + i * 2 + 1];
 
             for(int j = 0; j < length && logicalIndex < totalLogicalSize; j++){
@@ -172,13 +1532,13 @@ void copyProcessToMemory(int* processLogicalMemory,int totalLogicalSize, int* PC
         }
 
         if (logicalIndex < totalLogicalSize) {
-            cout << "Error: not enough space in allocated segments to hold process." <<
-            endl;
+            logEvent(EVENT_SEGMENT_OVERFLOW, 0, -1);
             }
 }
 
-
-int translateLogicalToPhysical(int logicalAddress, int* PCB){
+// Function to translate a logical address through a segment table
+// Returns the physical address or -1 if the address is past the last segment
+int translateLogicalToPhysical(int logicalAddress, const int* PCB){
     int segmentTableSize = PCB[0];
     int numSegments = segmentTableSize / 2;
     int remaining = logicalAddress;
@@ -193,503 +1553,5481 @@ int translateLogicalToPhysical(int logicalAddress, int* PCB){
         }
 
     }
-    cout << "Memory violation: address " << logicalAddress << " out of bounds." << endl;
+    logEvent(EVENT_MEMORY_VIOLATION, 0, -1, {logicalAddress});
 return -1;
 }
 
+// Page table entry of a paged process
+struct pageEntry
+{
+    int frame = -1;         // address of the frame holding the page, -1 if it is not resident
+    int block = -1;         // allocator block of the frame
+    int swapSlot = -1;      // swap slot holding the page, -1 while every word of it is -1
+    int residentIndex = -1; // position in the resident page list, -1 for a pinned page
+    bool referenced = false;
+    bool dirty = false;     // written since it was brought in
+    int lastUse = 0;        // clock of the last reference
+};
 
+// Resident page, identified by the owner's process slot and its page number
+struct residentPage
+{
+    int slot;
+    int page;
+};
 
-// Function to load jobs into memory
-// This function checks if there is sufficient memory available
-// and loads the job into memory if possible
-// If not, it attempts to coalesce memory blocks
-// and retry loading the job
-// If still not possible, the job is left in the new job queue
-// until memory becomes available
-void loadJobsToMemory(queue<PCB> &newJobQueue, queue<int> &readyQueue, int *mainMemory,
-                      int maxMemory, list<memoryBlock> &memoryList)
+// Paging counters, reported at the end of a paged run
+struct pagingCounters
 {
-    int lastAddress = 0;
-    int N = 0;  
-    while (!newJobQueue.empty())
-    {
+    long long references = 0; // instruction fetches and Load/Store accesses
+    long long faults = 0;
+    long long swapIns = 0;
+    long long swapOuts = 0;
+    long long evictions = 0;
+    long long stallCycles = 0; // fault latency charged to the clock
+};
 
-       // printList(memoryList); // Debug output
+const int SWAP_INITIAL_SLOTS = 64;
 
-        queue<PCB> tempQueue;
-        
-        PCB newJob = newJobQueue.front();
-        
-        int pcbSize = 10;
-        int totalSize = pcbSize + newJob.maxMemoryNeeded;
-        bool loaded = false;
+// Paged memory: main memory is split into frames of pageSize words, every
+// allocator block is one frame. Page 0 of a process holds its PCB and is
+// pinned while the process is resident, so the PCB stays at the start
+// address the queues refer to. Other pages are brought in when they are
+// first referenced and evicted to a memory mapped swap file once no frame
+// is free
+struct pagingState
+{
+    int pageSize = 16;
+    int faultTime = 20;        // cycles a page fault stalls the faulting core
+    int policy = REPLACE_CLOCK;
+    int workingSetWindow = 1000; // cycles a page stays in the working set after its last reference
+    int frames = 0;            // frames main memory holds
+    int pinnedFrames = 0;      // frames holding a PCB page
+    vector<residentPage> resident; // evictable pages, in clock hand order
+    int hand = 0;
+    int swapFd = -1;
+    memoryWord *swap = NULL;   // mapping of the swap file
+    int swapSlots = 0;         // slots the swap file holds
+    int usedSlots = 0;         // slots handed out so far, freed ones are reused first
+    vector<int> freeSlots;
+    pagingCounters counters;
+};
 
-        for (auto it = memoryList.begin(); it != memoryList.end(); it++)
+// Function to open the swap file, an empty path makes an unnamed temporary one
+// Returns false if the file cannot be created
+bool openSwap(pagingState &paging, const string &path)
+{
+    if (path.empty())
+    {
+        char name[] = "/tmp/swap-XXXXXX";
+        paging.swapFd = mkstemp(name);
+        if (paging.swapFd != -1)
         {
-            if (it->processID == -1 && it->size >= totalSize)
-            {
-                // Allocate the block
-                int startAddress = it->startingAddress;
-                it->processID = newJob.processID;
-                int originalSize = it->size;
-                it->size = totalSize;
+            unlink(name);
+        }
+    }
+    else
+    {
+        paging.swapFd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    return paging.swapFd != -1;
+}
 
-                // Split the block if it’s larger than needed
-                if (originalSize > totalSize)
-                {
-                    memoryList.insert(std::next(it), memoryBlock(-1, startAddress + totalSize, originalSize - totalSize));
-                }
+void closeSwap(pagingState &paging)
+{
+    if (paging.swap != NULL)
+    {
+        munmap(paging.swap, (size_t)paging.swapSlots * paging.pageSize * sizeof(memoryWord));
+        paging.swap = NULL;
+    }
+    if (paging.swapFd != -1)
+    {
+        close(paging.swapFd);
+        paging.swapFd = -1;
+    }
+}
 
-                newJob.mainMemoryBase = startAddress;
-                newJob.instructionBase = startAddress + pcbSize;
-                newJob.dataBase = newJob.instructionBase + newJob.instructionSize;
-                newJob.state = 1;
-
-                // Store PCB fields
-                mainMemory[startAddress] = newJob.processID;
-                mainMemory[startAddress+ 1] = newJob.state;
-                mainMemory[startAddress+ 2] = newJob.programCounter;
-                mainMemory[startAddress + 3] = newJob.instructionBase;
-                mainMemory[startAddress + 4] = newJob.dataBase;
-                mainMemory[startAddress+ 5] = newJob.memoryLimit;
-                mainMemory[startAddress+ 6] = newJob.cpuCyclesUsed;
-                mainMemory[startAddress+ 7] = newJob.registerValue;
-                mainMemory[startAddress+ 8] = newJob.maxMemoryNeeded;
-                mainMemory[startAddress + 9] = newJob.mainMemoryBase;
-
-                // Load instructions
-                int j = 0;
-                for (int i = 0; i < newJob.instructionSize; i++)
-                {
-                    mainMemory[newJob.instructionBase + i] = newJob.logicalMemory[j];
-                    if (newJob.logicalMemory[j] == 1 || newJob.logicalMemory[j] == 3)
-                    {
-                        j += 3;
-                    }
-                    else
-                    {
-                        j += 2;
-                    }
-                }
+// Function to grow the swap file and its mapping to at least the given slot count
+// New slots read as -1, like free main memory
+void reserveSwap(pagingState &paging, int slots)
+{
+    if (slots <= paging.swapSlots)
+    {
+        return;
+    }
+    int newSlots = max(max(slots, SWAP_INITIAL_SLOTS), paging.swapSlots * 2);
+    size_t slotBytes = (size_t)paging.pageSize * sizeof(memoryWord);
+    if (ftruncate(paging.swapFd, (off_t)(newSlots * slotBytes)) != 0)
+    {
+        throw bad_alloc();
+    }
+    void *mapping = mmap(NULL, newSlots * slotBytes, PROT_READ | PROT_WRITE, MAP_SHARED, paging.swapFd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        throw bad_alloc();
+    }
+    if (paging.swap != NULL)
+    {
+        munmap(paging.swap, paging.swapSlots * slotBytes);
+    }
+    paging.swap = (memoryWord *)mapping;
+    paging.swapSlots = newSlots;
+}
+
+// Function to hand out a swap slot, growing the swap file when every slot is in use
+int allocateSwapSlot(pagingState &paging)
+{
+    if (!paging.freeSlots.empty())
+    {
+        int slot = paging.freeSlots.back();
+        paging.freeSlots.pop_back();
+        return slot;
+    }
+    reserveSwap(paging, paging.usedSlots + 1);
+    return paging.usedSlots++;
+}
 
+memoryWord *swapPage(const pagingState &paging, int slot)
+{
+    return paging.swap + (size_t)slot * paging.pageSize;
+}
 
-                //TODO
-                //try to allocate multiple non contig blocks where total size is satisfied for the jobs requirement
-                //Coalesce adjacent blocks if possible
-                //if avaliable
-                //Allocate block of at least  13 ints to hold segment table
-                //Allocate segments for data
-                //Fill segment table and complete pcb fields
-                //Copy contents of PCB (segmentTable + metadata + instructions + data) into allocated segments as per layout
-                //PCB and its segment table and fields may span across many phys memory blocks(segments) as indicated in segment table
-                //Move the job to readyqueue
+// Fork counters, reported at the end of a run that forked
+struct sharingCounters
+{
+    long long forks = 0;
+    long long failedForks = 0;
+    long long faults = 0;          // Stores that copied a shared page
+    long long wordsCopied = 0;
+    long long sharedWords = 0;     // words mapped by more than one process, counted once per extra mapping
+    long long peakSharedWords = 0;
+};
 
-                //though
-                //if memory is not sufficient (total or segment table)
-                //leave the job in newJobQueue  
+// Owner of a shared page whose owner no longer maps it
+const long long SHARED_PAGE_OWNER = LLONG_MIN + 1;
 
+// Copy-on-write sharing between forked processes: a process that forks is
+// split into pages of pageSize words, every allocator block one page. Page 0
+// holds the PCB and is private, the child gets a copy of it; the other pages
+// are mapped by parent and child alike until one of them stores to it. The
+// block of a page counts the processes mapping it and is freed with the last
+struct sharingState
+{
+    int pageSize = 16;
+    sharingCounters counters;
+};
 
+const int TLB_ENTRIES = 16; // power of two
 
-                // Load data
-                j = 0;
-                for (int i = newJob.dataBase; i < newJob.dataBase + newJob.maxMemoryNeeded - 1 && j < newJob.logicalMemory.size(); i++)
-                {
-                    if (newJob.logicalMemory[j] == 1 || newJob.logicalMemory[j] == 3)
-                    {
-                        mainMemory[i] = newJob.logicalMemory[j + 1];
-                        mainMemory[i + 1] = newJob.logicalMemory[j + 2];
-                        i++;
-                        j += 3;
-                    }
-                    else if (newJob.logicalMemory[j] == 2 || newJob.logicalMemory[j] == 4)
-                    {
-                        mainMemory[i] = newJob.logicalMemory[j + 1];
-                        j += 2;
-                    }
-                }
-                readyQueue.push(newJob.mainMemoryBase);
-                lastAddress = newJob.instructionBase + newJob.maxMemoryNeeded + pcbSize;
-                cout << "Process " << newJob.processID << " loaded into memory at address "
-                     << it->startingAddress << " with size " << newJob.maxMemoryNeeded + pcbSize << "." << endl;
-                loaded = true;
-                break;
-            }
-        }
+// Translation counters, reported at the end of a segmented run
+struct translationCounters
+{
+    long long segmentHits = 0; // answered by the last segment
+    long long cacheHits = 0;   // answered by the direct-mapped cache
+    long long misses = 0;      // needed a binary search
+};
 
-        if (!loaded) {
-            cout << "Insufficient memory for Process " << newJob.processID 
-                 << ". Attempting memory coalescing." << endl;
-            bool coalesced = coalesce(memoryList);
+// Cached address translation of a segmented process
+// segmentEnds[i] is the logical address one past segment i, so a lookup is a
+// binary search; the segment of the last translation and a direct-mapped
+// cache of recent addresses answer most lookups before that
+struct segmentTranslation
+{
+    vector<int> segmentStarts; // physical start of each segment
+    vector<int> segmentEnds;
+    int lastSegment = 0;
+    int cachedLogical[TLB_ENTRIES];
+    int cachedPhysical[TLB_ENTRIES];
+    translationCounters *counters; // shared by every process of a simulation
+    pagingState *paging = NULL;    // set for a paged process, which has a page table instead of segments
+    sharingState *sharing = NULL;  // set for a process that forked or was forked, which has one too
+    vector<pageEntry> pages;
+    int sharedSize = 0;            // words mapped by the page table of a forked process
+};
 
-            if (coalesced && hasSufficientMemoryBlock(memoryList, newJob.maxMemoryNeeded +  pcbSize)) {
-                cout << "Memory coalesced. Process " << newJob.processID << " can now be loaded."<< endl;
-            } else {
-                cout << "Process " << newJob.processID 
-                     << " waiting in NewJobQueue due to insufficient memory." << endl;
-                
-                break;
-            }
-        }
-        else {
-            newJobQueue.pop();
-        }
+// Function to empty the translation cache
+// Must be called whenever a segment of the process moves
+void invalidateTranslation(segmentTranslation &translation)
+{
+    translation.lastSegment = 0;
+    for (int i = 0; i < TLB_ENTRIES; i++)
+    {
+        translation.cachedLogical[i] = -1;
+    }
 }
+
+// Function to build the cumulative-length index of a segment table
+// A NULL segment table clears the index
+void buildTranslation(segmentTranslation &translation, const int *segmentTable)
+{
+    translation.segmentStarts.clear();
+    translation.segmentEnds.clear();
+    int numSegments = segmentTable == NULL ? 0 : segmentTable[0] / 2;
+    int end = 0;
+    for (int i = 0; i < numSegments; i++)
+    {
+        end += segmentTable[1 + i * 2 + 1];
+        translation.segmentStarts.push_back(segmentTable[1 + i * 2]);
+        translation.segmentEnds.push_back(end);
+    }
+    invalidateTranslation(translation);
 }
-// Function to print the contents of the new job queue
-// This function is used for debugging purposes
-void printNewJobQueue(queue<PCB> jobQueue) {
-    cout << "New Job Queue Contents:" << endl;
-    cout << "Total Jobs: " << jobQueue.size() << endl;
-    
-    // Create a copy of the queue to avoid modifying the original
-    queue<PCB> tempQueue = jobQueue;
-    
-    while (!tempQueue.empty()) {
-        PCB job = tempQueue.front();
-        tempQueue.pop();
-        
-        cout << "Process ID: " << job.processID << endl;
-        cout << "  Memory Needed: " << job.maxMemoryNeeded << endl;
-        cout << "  Instruction Size: " << job.instructionSize << endl;
-        cout << "  Logical Memory Contents:" << endl;
-        
-        // Print logical memory contents
-        for (size_t i = 0; i < job.logicalMemory.size(); ) {
-            int opcode = job.logicalMemory[i];
-            cout << "    Opcode: " << opcode;
-            
-            switch (opcode) {
-                case 1: // Compute
-                    cout << " (Compute): Iterations = " << job.logicalMemory[i+1] 
-                         << ", Cycles = " << job.logicalMemory[i+2] << endl;
-                    i += 3;
-                    break;
-                case 2: // Print
-                    cout << " (Print): IO Cycles = " << job.logicalMemory[i+1] << endl;
-                    i += 2;
-                    break;
-                case 3: // Store
-                    cout << " (Store): Value = " << job.logicalMemory[i+1] 
-                         << ", Address = " << job.logicalMemory[i+2] << endl;
-                    i += 3;
-                    break;
-                case 4: // Load
-                    cout << " (Load): Address = " << job.logicalMemory[i+1] << endl;
-                    i += 2;
-                    break;
-                default:
-                    cout << " (Unknown Opcode)" << endl;
-                    i++;
-                    break;
+
+// Function to translate a logical address of a segmented process
+// Returns the physical address or -1 if the address is past the last segment
+int translateAddress(segmentTranslation &translation, int logicalAddress)
+{
+    int segment = translation.lastSegment;
+    int segmentBase = segment == 0 ? 0 : translation.segmentEnds[segment - 1];
+    if (logicalAddress >= segmentBase && logicalAddress < translation.segmentEnds[segment])
+    {
+        translation.counters->segmentHits++;
+        return translation.segmentStarts[segment] + logicalAddress - segmentBase;
+    }
+    int line = logicalAddress & (TLB_ENTRIES - 1);
+    if (translation.cachedLogical[line] == logicalAddress)
+    {
+        translation.counters->cacheHits++;
+        return translation.cachedPhysical[line];
+    }
+    translation.counters->misses++;
+    segment = upper_bound(translation.segmentEnds.begin(), translation.segmentEnds.end(), logicalAddress) -
+              translation.segmentEnds.begin();
+    if (logicalAddress < 0 || segment == (int)translation.segmentEnds.size())
+    {
+        logEvent(EVENT_MEMORY_VIOLATION, 0, -1, {logicalAddress});
+        return -1;
+    }
+    segmentBase = segment == 0 ? 0 : translation.segmentEnds[segment - 1];
+    int physical = translation.segmentStarts[segment] + logicalAddress - segmentBase;
+    translation.lastSegment = segment;
+    translation.cachedLogical[line] = logicalAddress;
+    translation.cachedPhysical[line] = physical;
+    return physical;
+}
+
+// Function to read a word of a paged process without faulting its page in
+// A page that is not resident is read from swap, words past the end of the
+// process and pages never written read as -1
+int pagedWord(const memoryWord *mainMemory, const segmentTranslation &translation, int address)
+{
+    int page = address / translation.paging->pageSize;
+    int offset = address % translation.paging->pageSize;
+    if (address < 0 || page >= (int)translation.pages.size())
+    {
+        return -1;
+    }
+    const pageEntry &entry = translation.pages[page];
+    if (entry.frame != -1)
+    {
+        return mainMemory[entry.frame + offset];
+    }
+    return entry.swapSlot == -1 ? -1 : swapPage(*translation.paging, entry.swapSlot)[offset];
+}
+
+// Function to read a word of a process that shares pages copy-on-write
+// Words past the end of the process read as -1
+int sharedWord(const memoryWord *mainMemory, const segmentTranslation &translation, int address)
+{
+    if (address < 0 || address >= translation.sharedSize)
+    {
+        return -1;
+    }
+    int pageSize = translation.sharing->pageSize;
+    return mainMemory[translation.pages[address / pageSize].frame + address % pageSize];
+}
+
+// Function to read a word of a process's address space
+// Contiguous processes have no translation and are addressed physically,
+// words past the end of a segmented process read as -1
+int programWord(const memoryWord *mainMemory, segmentTranslation *translation, int address)
+{
+    if (translation == NULL)
+    {
+        return mainMemory[address];
+    }
+    if (translation->paging != NULL)
+    {
+        return pagedWord(mainMemory, *translation, address);
+    }
+    if (translation->sharing != NULL)
+    {
+        return sharedWord(mainMemory, *translation, address);
+    }
+    int physical = translateAddress(*translation, address);
+    return physical == -1 ? -1 : mainMemory[physical];
+}
+
+// Micro-op kinds, a program is decoded into these once it is loaded
+enum microOpKind
+{
+    MICRO_INVALID,     // opcode the simulator does not know
+    MICRO_COMPUTE,     // value = cycles
+    MICRO_PRINT,       // value = IO cycles
+    MICRO_STORE,       // value stored at address
+    MICRO_STORE_ERROR, // Store whose address is outside the process
+    MICRO_LOAD,        // register loaded from address
+    MICRO_LOAD_ERROR,  // Load whose address is outside the process
+    MICRO_STORE_TRANSLATED, // Store to a logical address of a segmented process
+    MICRO_LOAD_TRANSLATED,  // Load from a logical address of a segmented process
+    MICRO_STORE_PAGED,      // Store to a logical address of a paged process
+    MICRO_LOAD_PAGED,       // Load from a logical address of a paged process
+    MICRO_STORE_SHARED,     // Store to a logical address of a forked process, copies a shared page
+    MICRO_LOAD_SHARED,      // Load from a logical address of a forked process
+    MICRO_FORK,             // value = child PID
+    MICRO_FILL,             // value stored at count words from address
+    MICRO_COPY,             // count words copied from value (the source address) to address
+    MICRO_SUM,              // register loaded with the sum of count words from address
+    MICRO_FILL_TRANSLATED,  // Fill of logical addresses of a segmented, paged or forked process
+    MICRO_COPY_TRANSLATED,  // Copy between logical addresses of a segmented, paged or forked process
+    MICRO_SUM_TRANSLATED,   // Sum of logical addresses of a segmented, paged or forked process
+    MICRO_BULK_ERROR        // Fill, Copy or Sum of a range outside the process
+};
+
+// Decoded instruction with its operands resolved to values and addresses
+// Addresses are physical, except for the translated kinds
+struct microOp
+{
+    int kind;
+    int value;
+    int address;
+    int count; // words covered by a Fill, Copy or Sum
+};
+
+// Bulk memory instructions and their cost: a Fill, Copy or Sum takes one
+// cycle plus one for every wordsPerCycle words it covers
+struct bulkMemoryState
+{
+    int wordsPerCycle = 8;
+    long long instructions = 0;
+    long long words = 0;
+    long long cycles = 0;
+
+    // Function to count a bulk instruction covering count words, returns the cycles it takes
+    int charge(int count)
+    {
+        int cost = 1 + (count + wordsPerCycle - 1) / wordsPerCycle;
+        instructions++;
+        words += count;
+        cycles += cost;
+        return cost;
+    }
+};
+
+// Cost added to the cumulative cycles by an instruction that is not a
+// Compute, larger than any time slice so no run of Computes crosses it
+const long long COMPUTE_RUN_BARRIER = 1LL << 32;
+
+// Cumulative cycles of a decoded program: cycles[i] is the cost of the
+// instructions before i, each Compute counting its cycles and every other
+// instruction COMPUTE_RUN_BARRIER. The cycles are non-decreasing, so the
+// Computes that fit in the rest of a time slice are found by binary search
+struct computeRuns
+{
+    vector<long long> cycles;
+    bool stale = true; // an operand changed since the cycles were summed
+};
+
+// Process table entry for a process resident in main memory
+struct processEntry
+{
+    long long processID;
+    int blocks[MAX_SEGMENTS]; // allocator blocks holding the process, the first one holds the PCB
+    int blockCount;
+    int segmentTable;   // address of the segment table, -1 for a contiguous process
+    segmentTranslation translation; // rebuilt whenever the segment table changes
+    int mainMemoryBase; // address of the PCB in main memory
+    int loadTime;       // clock when the process was loaded into memory
+    int startTime;      // -1 until the process first runs
+    int endTime;
+    int priority;       // lower runs first under the priority scheduler
+    int queueLevel;     // feedback queue level under the MLFQ scheduler
+    int lastCore;       // core the process last ran on, -1 before its first run
+    long long waitingTime; // cycles spent in ready queues
+    vector<int> dataOffsets; // dataOffsets[i] = offset of instruction i's operands from dataBase
+    vector<microOp> program; // decoded instructions, kept in sync with main memory by Stores
+    computeRuns runs;        // built from program when a Compute first needs them
+};
+
+// Process table of resident processes, indexed by PID and by PCB address
+// PCB word 0 in main memory only holds the low 32 bits of a 64-bit PID,
+// so the table is the authority for the full value
+struct processTable
+{
+    vector<processEntry> entries;
+    vector<int> unusedSlots;
+    hashIndex byProcessID;
+    hashIndex byBaseAddress;
+    translationCounters translationStats;
+    vector<int> loadImage; // scratch logical image of the segmented job being loaded
+};
+
+// Function to add a resident process to the table
+// The process starts with a single contiguous block
+// Returns the process slot
+int addProcess(processTable &processes, long long processID, int block, int mainMemoryBase)
+{
+    int slot;
+    if (!processes.unusedSlots.empty())
+    {
+        slot = processes.unusedSlots.back();
+        processes.unusedSlots.pop_back();
+    }
+    else
+    {
+        slot = processes.entries.size();
+        processes.entries.push_back(processEntry());
+    }
+    processEntry &process = processes.entries[slot];
+    process.processID = processID;
+    process.blocks[0] = block;
+    process.blockCount = 1;
+    process.segmentTable = -1;
+    process.translation.counters = &processes.translationStats;
+    buildTranslation(process.translation, NULL);
+    process.translation.paging = NULL;
+    process.translation.sharing = NULL;
+    process.mainMemoryBase = mainMemoryBase;
+    process.loadTime = 0;
+    process.startTime = -1;
+    process.endTime = -1;
+    process.priority = 0;
+    process.queueLevel = 0;
+    process.lastCore = -1;
+    process.waitingTime = 0;
+    hashIndexInsert(processes.byProcessID, processID, slot);
+    hashIndexInsert(processes.byBaseAddress, mainMemoryBase, slot);
+    return slot;
+}
+
+// Function to find the slot of a process by its PID, -1 if it is not resident
+int findProcess(const processTable &processes, long long processID)
+{
+    return hashIndexFind(processes.byProcessID, processID);
+}
+
+// Function to find the slot of the process whose PCB starts at the given address
+int findProcessAt(const processTable &processes, int mainMemoryBase)
+{
+    return hashIndexFind(processes.byBaseAddress, mainMemoryBase);
+}
+
+void removeProcess(processTable &processes, int slot)
+{
+    processEntry &process = processes.entries[slot];
+    hashIndexErase(processes.byProcessID, process.processID);
+    hashIndexErase(processes.byBaseAddress, process.mainMemoryBase);
+    buildTranslation(process.translation, NULL);
+    processes.unusedSlots.push_back(slot);
+}
+
+// Function to take a page off the resident list
+// The last page takes its place, which keeps the list dense at the cost of
+// moving that page in the clock hand order
+void removeResident(pagingState &paging, processTable &processes, int index)
+{
+    residentPage moved = paging.resident.back();
+    paging.resident[index] = moved;
+    processes.entries[moved.slot].translation.pages[moved.page].residentIndex = index;
+    paging.resident.pop_back();
+    if (paging.hand >= (int)paging.resident.size())
+    {
+        paging.hand = 0;
+    }
+}
+
+// Function to pick the resident page to evict under the configured policy
+// Returns an index into the resident list, which must not be empty
+int chooseVictim(pagingState &paging, processTable &processes, int clock)
+{
+    vector<residentPage> &resident = paging.resident;
+    int count = resident.size();
+    auto entryAt = [&](int index) -> pageEntry &
+    {
+        return processes.entries[resident[index].slot].translation.pages[resident[index].page];
+    };
+    auto leastRecentlyUsed = [&]()
+    {
+        int victim = 0;
+        for (int i = 1; i < count; i++)
+        {
+            if (entryAt(i).lastUse < entryAt(victim).lastUse)
+            {
+                victim = i;
             }
         }
-        cout << endl;
+        return victim;
+    };
+    if (paging.policy == REPLACE_LRU)
+    {
+        return leastRecentlyUsed();
+    }
+    if (paging.policy == REPLACE_CLOCK)
+    { // at most one full turn clearing reference bits, then the hand finds a clear one
+        for (;;)
+        {
+            pageEntry &entry = entryAt(paging.hand);
+            if (!entry.referenced)
+            {
+                return paging.hand;
+            }
+            entry.referenced = false;
+            paging.hand = (paging.hand + 1) % count;
+        }
+    }
+    // WSClock: a referenced page is in the working set, it is aged and
+    // skipped; so is an unreferenced page used within the window
+    for (int step = 0; step < count; step++)
+    {
+        pageEntry &entry = entryAt(paging.hand);
+        if (entry.referenced)
+        {
+            entry.referenced = false;
+            entry.lastUse = max(entry.lastUse, clock);
+        }
+        else if (clock - entry.lastUse > paging.workingSetWindow)
+        {
+            return paging.hand;
+        }
+        paging.hand = (paging.hand + 1) % count;
     }
+    return leastRecentlyUsed(); // every page is in some working set
 }
-// Function to execute the CPU instructions
-// It updates the program counter, CPU cycles used, and register value
-// It also handles I/O interrupts and memory management
-// The function takes the starting address of the process in memory
-// and updates the main memory, global clock, and other parameters  
-void executeCPU(int startAddress, int *mainMemory, int CPUAllocated, int &globalClock,
-                queue<IOWaitEntry> &ioWaitQueue, queue<int> &readyQueue, int &totalCpuTime, vector<int> &processStartTimes, list<memoryBlock> &memoryList, int maxMemory, queue<PCB> &newJobQueue)
+
+// Function to evict one resident page, writing it to swap if it was changed
+// Returns false if no page can be evicted
+bool evictPage(pagingState &paging, memoryAllocator &memoryList, memoryWord *mainMemory, processTable &processes,
+               int clock)
 {
-    int processID = mainMemory[startAddress];
-    int programCounter = mainMemory[startAddress + 2];
-    // cout<< "Prog counter: " <<  programCounter << endl;
-    int instructionBase = mainMemory[startAddress + 3];
-    // cout<< "Instruction Base1: " <<  instructionBase << endl;
-    int dataBase = mainMemory[startAddress + 4];
-    int memoryLimit = mainMemory[startAddress + 5];
-    int cpuCyclesUsed = mainMemory[startAddress + 6];
-    int registerValue = mainMemory[startAddress + 7];
+    if (paging.resident.empty())
+    {
+        return false;
+    }
+    int index = chooseVictim(paging, processes, clock);
+    residentPage victim = paging.resident[index];
+    processEntry &owner = processes.entries[victim.slot];
+    pageEntry &entry = owner.translation.pages[victim.page];
+    if (entry.dirty)
+    {
+        if (entry.swapSlot == -1)
+        {
+            entry.swapSlot = allocateSwapSlot(paging);
+        }
+        memcpy(swapPage(paging, entry.swapSlot), mainMemory + entry.frame, paging.pageSize * sizeof(memoryWord));
+        paging.counters.swapOuts++;
+    }
+    logEvent(EVENT_PAGE_EVICTED, clock, owner.processID, {victim.page, entry.frame});
+    releaseWords(mainMemory, entry.frame, paging.pageSize);
+    releaseBlock(memoryList, entry.block);
+    entry.frame = -1;
+    entry.block = -1;
+    entry.residentIndex = -1;
+    entry.referenced = false;
+    entry.dirty = false;
+    removeResident(paging, processes, index);
+    paging.counters.evictions++;
+    return true;
+}
 
-    int maxMemoryNeeded = mainMemory[startAddress + 8];
-    int mainMemoryBase = mainMemory[startAddress + 9];
+// Function to get a free frame for the given process, evicting pages until one is free
+// Returns the allocator block of the frame or -1 if every frame is pinned
+int allocateFrame(pagingState &paging, memoryAllocator &memoryList, memoryWord *mainMemory, processTable &processes,
+                  long long processID, int clock)
+{
+    int block = allocateBlock(memoryList, processID, paging.pageSize);
+    while (block == -1 && evictPage(paging, memoryList, mainMemory, processes, clock))
+    {
+        block = allocateBlock(memoryList, processID, paging.pageSize);
+    }
+    return block;
+}
+
+// Function to bring a page of a process into a frame
+// The fault stalls the caller for faultTime cycles, added to clock
+// Returns false if no frame could be found for it
+bool pageIn(pagingState &paging, memoryAllocator &memoryList, memoryWord *mainMemory, processTable &processes,
+            int slot, int page, int &clock)
+{
+    long long processID = processes.entries[slot].processID;
+    logEvent(EVENT_PAGE_FAULT, clock, processID, {page});
+    paging.counters.faults++;
+    paging.counters.stallCycles += paging.faultTime;
+    clock += paging.faultTime;
+    int block = allocateFrame(paging, memoryList, mainMemory, processes, processID, clock);
+    if (block == -1)
+    {
+        return false;
+    }
+    pageEntry &entry = processes.entries[slot].translation.pages[page];
+    entry.block = block;
+    entry.frame = memoryList.blocks[block].startingAddress;
+    if (entry.swapSlot != -1)
+    { // a page that was never written stays -1, which the free frame already holds
+        memcpy(mainMemory + entry.frame, swapPage(paging, entry.swapSlot), paging.pageSize * sizeof(memoryWord));
+        paging.counters.swapIns++;
+    }
+    entry.dirty = false;
+    entry.residentIndex = paging.resident.size();
+    paging.resident.push_back({slot, page});
+    return true;
+}
+
+// Function to translate a logical address of a paged process, faulting its page in if needed
+// Returns the physical address, or -1 if the address is outside the process
+// or its page cannot be brought in
+int pageAddress(pagingState &paging, memoryAllocator &memoryList, memoryWord *mainMemory, processTable &processes,
+                int slot, int address, bool write, int &clock)
+{
+    vector<pageEntry> &pages = processes.entries[slot].translation.pages;
+    int page = address / paging.pageSize;
+    if (address < 0 || page >= (int)pages.size())
+    {
+        logEvent(EVENT_MEMORY_VIOLATION, clock, -1, {address});
+        return -1;
+    }
+    paging.counters.references++;
+    if (pages[page].frame == -1 && !pageIn(paging, memoryList, mainMemory, processes, slot, page, clock))
+    {
+        return -1;
+    }
+    pageEntry &entry = pages[page];
+    entry.referenced = true;
+    entry.dirty = entry.dirty || write;
+    entry.lastUse = clock;
+    return entry.frame + address % paging.pageSize;
+}
+
+// Function to release the frames and swap slots of a paged process, its pinned PCB frame excepted
+void releasePages(pagingState &paging, memoryAllocator &memoryList, memoryWord *mainMemory, processTable &processes,
+                  int slot)
+{
+    vector<pageEntry> &pages = processes.entries[slot].translation.pages;
+    for (size_t page = 1; page < pages.size(); page++)
+    {
+        pageEntry &entry = pages[page];
+        if (entry.frame != -1)
+        {
+            releaseWords(mainMemory, entry.frame, paging.pageSize);
+            releaseBlock(memoryList, entry.block);
+            removeResident(paging, processes, entry.residentIndex);
+        }
+        if (entry.swapSlot != -1)
+        {
+            paging.freeSlots.push_back(entry.swapSlot);
+        }
+    }
+    pages.clear();
+    paging.pinnedFrames--;
+}
+
+// Function to drop one process's mapping of a shared page, freeing the page with its last mapping
+// A page dropped by its owner while others still map it is left without an owner
+void unmapSharedPage(sharingState &sharing, memoryAllocator &memoryList, memoryWord *mainMemory, int index,
+                     long long processID)
+{
+    memoryBlock &page = memoryList.blocks[index];
+    page.sharers--;
+    if (page.sharers > 0)
+    {
+        sharing.counters.sharedWords -= page.size;
+        if (page.processID == processID)
+        {
+            page.processID = SHARED_PAGE_OWNER;
+        }
+        return;
+    }
+    releaseWords(mainMemory, page.startingAddress, page.size);
+    releaseBlock(memoryList, index);
+}
+
+// Function to translate a logical address a forked process stores to
+// A page other processes still map is copied to a block of the process's
+// own first; the last process mapping a page writes it in place
+// Returns the physical address, or -1 if no block is free for the copy
+int writableAddress(sharingState &sharing, memoryAllocator &memoryList, memoryWord *mainMemory,
+                    processEntry &process, int address, int clock)
+{
+    int page = address / sharing.pageSize;
+    pageEntry &entry = process.translation.pages[page];
+    if (memoryList.blocks[entry.block].sharers > 1)
+    {
+        int size = memoryList.blocks[entry.block].size;
+        int copy = findFreeBlockCoalescing(memoryList, size);
+        if (copy == -1)
+        {
+            return -1;
+        }
+        claimBlock(memoryList, copy, process.processID, size);
+        int frame = memoryList.blocks[copy].startingAddress;
+        memcpy(mainMemory + frame, mainMemory + entry.frame, size * sizeof(memoryWord));
+        memoryList.blocks[copy].sharers = 1;
+        unmapSharedPage(sharing, memoryList, mainMemory, entry.block, process.processID);
+        entry.frame = frame;
+        entry.block = copy;
+        sharing.counters.faults++;
+        sharing.counters.wordsCopied += size;
+        logEvent(EVENT_COW_FAULT, clock, process.processID, {page});
+    }
+    return entry.frame + address % sharing.pageSize;
+}
+
+// Function to drop every page mapping of a forked process but its PCB page, which is freed with the process
+void releaseSharedPages(sharingState &sharing, memoryAllocator &memoryList, memoryWord *mainMemory,
+                        processEntry &process)
+{
+    vector<pageEntry> &pages = process.translation.pages;
+    for (size_t page = 1; page < pages.size(); page++)
+    {
+        unmapSharedPage(sharing, memoryList, mainMemory, pages[page].block, process.processID);
+    }
+    pages.clear();
+}
+
+// Function to get the number of data words an instruction takes
+// Fill and Copy take three, Compute, Store and Sum two, Print, Load and Fork
+// one; an unknown opcode takes none
+int operandCount(int opcode)
+{
+    switch (opcode)
+    {
+    case 6:
+    case 7:
+        return 3;
+    case 1:
+    case 3:
+    case 8:
+        return 2;
+    case 2:
+    case 4:
+    case 5:
+        return 1;
+    }
+    return 0;
+}
+
+// Function to build the data offset table of a program
+// The operands of instruction i start at the sum of the operand counts before it
+void buildDataOffsets(const memoryWord *mainMemory, segmentTranslation *translation, int instructionBase, int instructionSize,
+                      vector<int> &dataOffsets)
+{
+    dataOffsets.resize(instructionSize + 1);
+    int offset = 0;
+    for (int i = 0; i < instructionSize; i++)
+    {
+        dataOffsets[i] = offset;
+        offset += operandCount(programWord(mainMemory, translation, instructionBase + i));
+    }
+    dataOffsets[instructionSize] = offset;
+}
+
+// Function to check that count words from first lie within a process's memory
+// A Fill, Copy or Sum is checked once for its whole range instead of per word
+bool rangeInBounds(int first, int count, int instructionBase, int maxMemoryNeeded)
+{
+    return count >= 0 && first >= instructionBase &&
+           (long long)first + count <= (long long)instructionBase + maxMemoryNeeded;
+}
+
+// Function to decode one instruction from main memory
+// Operand values are read from the data area and Store/Load addresses and
+// Fill/Copy/Sum ranges are translated and bounds checked here, so executeCPU
+// does neither
+// Segmented, paged and forked processes are read through their translation (NULL
+// for a contiguous process) and keep logical addresses, which are translated
+// when the instruction runs
+microOp decodeInstruction(const memoryWord *mainMemory, segmentTranslation *translation, int instructionBase, int dataBase,
+                          int maxMemoryNeeded, int programCounter, int dataOffset)
+{
+    int data = dataBase + dataOffset;
+    int opcode = programWord(mainMemory, translation, instructionBase + programCounter);
+    microOp op = {MICRO_INVALID, opcode, 0, 0};
+    bool inBounds;
+    switch (opcode)
+    {
+    case 1: // Compute: 1 iterations cycles
+        op.kind = MICRO_COMPUTE;
+        op.value = programWord(mainMemory, translation, data + 1);
+        break;
+    case 2: // Print: 2 cycles
+        op.kind = MICRO_PRINT;
+        op.value = programWord(mainMemory, translation, data);
+        break;
+    case 3: // Store: 3 value address
+        op.value = programWord(mainMemory, translation, data);
+        op.address = instructionBase + programWord(mainMemory, translation, data + 1);
+        inBounds = op.address >= instructionBase && op.address < instructionBase + maxMemoryNeeded;
+        op.kind = !inBounds                       ? MICRO_STORE_ERROR
+                  : translation == NULL             ? MICRO_STORE
+                  : translation->paging != NULL     ? MICRO_STORE_PAGED
+                  : translation->sharing != NULL    ? MICRO_STORE_SHARED
+                                                    : MICRO_STORE_TRANSLATED;
+        break;
+    case 4: // Load: 4 address
+        op.address = instructionBase + programWord(mainMemory, translation, data);
+        inBounds = op.address >= instructionBase && op.address < instructionBase + maxMemoryNeeded;
+        op.kind = !inBounds                       ? MICRO_LOAD_ERROR
+                  : translation == NULL             ? MICRO_LOAD
+                  : translation->paging != NULL     ? MICRO_LOAD_PAGED
+                  : translation->sharing != NULL    ? MICRO_LOAD_SHARED
+                                                    : MICRO_LOAD_TRANSLATED;
+        break;
+    case 5: // Fork: 5 child PID
+        op.kind = MICRO_FORK;
+        op.value = programWord(mainMemory, translation, data);
+        break;
+    case 6: // Fill: 6 value address count
+        op.value = programWord(mainMemory, translation, data);
+        op.address = instructionBase + programWord(mainMemory, translation, data + 1);
+        op.count = programWord(mainMemory, translation, data + 2);
+        inBounds = rangeInBounds(op.address, op.count, instructionBase, maxMemoryNeeded);
+        op.kind = !inBounds ? MICRO_BULK_ERROR : translation == NULL ? MICRO_FILL : MICRO_FILL_TRANSLATED;
+        break;
+    case 7: // Copy: 7 source destination count
+        op.value = instructionBase + programWord(mainMemory, translation, data);
+        op.address = instructionBase + programWord(mainMemory, translation, data + 1);
+        op.count = programWord(mainMemory, translation, data + 2);
+        inBounds = rangeInBounds(op.value, op.count, instructionBase, maxMemoryNeeded) &&
+                   rangeInBounds(op.address, op.count, instructionBase, maxMemoryNeeded);
+        op.kind = !inBounds ? MICRO_BULK_ERROR : translation == NULL ? MICRO_COPY : MICRO_COPY_TRANSLATED;
+        break;
+    case 8: // Sum: 8 address count
+        op.address = instructionBase + programWord(mainMemory, translation, data);
+        op.count = programWord(mainMemory, translation, data + 1);
+        inBounds = rangeInBounds(op.address, op.count, instructionBase, maxMemoryNeeded);
+        op.kind = !inBounds ? MICRO_BULK_ERROR : translation == NULL ? MICRO_SUM : MICRO_SUM_TRANSLATED;
+        break;
+    }
+    return op;
+}
+
+// Function to get what an instruction adds to the cumulative cycles of its program
+// A Compute with a negative cycle count is a barrier too, it runs on its own
+long long runCycles(const microOp &op)
+{
+    return op.kind == MICRO_COMPUTE && op.value >= 0 ? op.value : COMPUTE_RUN_BARRIER;
+}
+
+// Function to sum the cumulative cycles of a decoded program
+void buildComputeRuns(const vector<microOp> &program, computeRuns &runs)
+{
+    runs.cycles.resize(program.size() + 1);
+    runs.cycles[0] = 0;
+    for (size_t i = 0; i < program.size(); i++)
+    {
+        runs.cycles[i + 1] = runs.cycles[i] + runCycles(program[i]);
+    }
+    runs.stale = false;
+}
+
+// Function to decode a whole program and rebuild its data offset table and cumulative cycles
+void decodeProgram(const memoryWord *mainMemory, segmentTranslation *translation, int instructionBase, int instructionSize,
+                   int maxMemoryNeeded, vector<int> &dataOffsets, vector<microOp> &program, computeRuns &runs)
+{
+    int dataBase = instructionBase + instructionSize;
+    buildDataOffsets(mainMemory, translation, instructionBase, instructionSize, dataOffsets);
+    program.resize(instructionSize);
+    runs.cycles.resize(instructionSize + 1);
+    runs.cycles[0] = 0;
+    for (int i = 0; i < instructionSize; i++)
+    {
+        program[i] = decodeInstruction(mainMemory, translation, instructionBase, dataBase, maxMemoryNeeded, i,
+                                       dataOffsets[i]);
+        runs.cycles[i + 1] = runs.cycles[i] + runCycles(program[i]);
+    }
+    runs.stale = false;
+}
+
+// Function to bring a decoded program up to date after a Store to the given address
+// by the instruction at programCounter
+// Overwriting an opcode can shift every later operand, so the program is decoded
+// again; overwriting an operand only changes the instruction that owns it, and
+// the cumulative cycles are summed again once a Compute needs them
+// Returns how far the rebuilt table moved the running instruction's operands,
+// which is nonzero only when an opcode before it changed its operand count
+int storeToProgram(const memoryWord *mainMemory, segmentTranslation *translation, int instructionBase, int instructionSize,
+                   int maxMemoryNeeded, vector<int> &dataOffsets, vector<microOp> &program, computeRuns &runs,
+                   int address, int programCounter)
+{
+    int dataBase = instructionBase + instructionSize;
+    if (address < dataBase)
+    {
+        int before = dataOffsets[programCounter];
+        decodeProgram(mainMemory, translation, instructionBase, instructionSize, maxMemoryNeeded, dataOffsets,
+                      program, runs);
+        return dataOffsets[programCounter] - before;
+    }
+    int dataOffset = address - dataBase;
+    if (dataOffset >= dataOffsets[instructionSize])
+    {
+        return 0; // plain data, no instruction reads it as an operand
+    }
+    int owner = upper_bound(dataOffsets.begin(), dataOffsets.end(), dataOffset) - dataOffsets.begin() - 1;
+    program[owner] = decodeInstruction(mainMemory, translation, instructionBase, dataBase, maxMemoryNeeded, owner,
+                                       dataOffsets[owner]);
+    runs.stale = runs.stale || runs.cycles[owner + 1] - runs.cycles[owner] != runCycles(program[owner]);
+    return 0;
+}
+
+// Function to bring a decoded program up to date after a Fill or Copy of count words from the given address
+// A range reaching the code or operands is rare, so the program is simply decoded again
+// Returns how far the running instruction's operands moved, as storeToProgram does
+int storeRangeToProgram(const memoryWord *mainMemory, segmentTranslation *translation, int instructionBase,
+                        int instructionSize, int maxMemoryNeeded, vector<int> &dataOffsets, vector<microOp> &program,
+                        computeRuns &runs, int address, int count, int programCounter)
+{
+    if (count <= 0 || address >= instructionBase + instructionSize + dataOffsets[instructionSize])
+    {
+        return 0;
+    }
+    int before = dataOffsets[programCounter];
+    decodeProgram(mainMemory, translation, instructionBase, instructionSize, maxMemoryNeeded, dataOffsets, program,
+                  runs);
+    return dataOffsets[programCounter] - before;
+}
 
-    if (processStartTimes[processID - 1] == -1)
+// Function to free a block of memory
+// and update the memory list
+// A segmented process releases each of its segments, a paged process its
+// frames and swap slots and a forked process its mappings of shared pages
+void freeBlock(long long processID, processTable &processes, memoryAllocator &memoryList, memoryWord *mainMemory,
+               int globalClock)
+{
+    int slot = findProcess(processes, processID);
+    if (slot == -1)
+    {
+        logEvent(EVENT_FREE_ERROR, globalClock, processID);
+        return;
+    }
+    if (memoryList.paging != NULL)
+    {
+        releasePages(*memoryList.paging, memoryList, mainMemory, processes, slot);
+    }
+    else if (processes.entries[slot].translation.sharing != NULL)
+    {
+        releaseSharedPages(*memoryList.sharing, memoryList, mainMemory, processes.entries[slot]);
+    }
+    const processEntry &process = processes.entries[slot];
+    for (int segment = 0; segment < process.blockCount; segment++)
+    {
+        int index = process.blocks[segment];
+        memoryBlock &block = memoryList.blocks[index];
+        logEvent(EVENT_MEMORY_RELEASED, globalClock, processID,
+                 {block.startingAddress, block.startingAddress + block.size - 1});
+
+        releaseWords(mainMemory, block.startingAddress, block.size);
+        releaseBlock(memoryList, index);
+    }
+    removeProcess(processes, slot);
+   // printList(memoryList); // Debug output
+}
+const int MLFQ_LEVELS = 3; // level n gets a time slice of quantum << n
+
+// Ready process, heap-ordered policies break key ties by arrival order
+struct readyEntry
+{
+    long long key;
+    long long sequence;
+    int startAddress;
+    int readyTime; // clock when the process became ready
+};
+
+struct laterReadyEntry
+{
+    bool operator()(const readyEntry &a, const readyEntry &b) const
+    {
+        if (a.key != b.key)
+        {
+            return a.key > b.key;
+        }
+        return a.sequence > b.sequence;
+    }
+};
+
+// FIFO bucket of ready entries kept in one vector
+// Popped entries leave a gap at the front that is closed by sliding the live
+// entries down once it is at least half the vector, so a bucket that has
+// reached its working size pushes and pops without allocating
+struct readyFifo
+{
+    vector<readyEntry> entries;
+    size_t head = 0; // first live entry
+
+    bool empty() const
+    {
+        return head == entries.size();
+    }
+    size_t size() const
+    {
+        return entries.size() - head;
+    }
+    readyEntry *begin()
+    {
+        return entries.data() + head;
+    }
+    readyEntry *end()
+    {
+        return entries.data() + entries.size();
+    }
+    const readyEntry *begin() const
+    {
+        return entries.data() + head;
+    }
+    const readyEntry *end() const
+    {
+        return entries.data() + entries.size();
+    }
+    const readyEntry &front() const
+    {
+        return entries[head];
+    }
+    const readyEntry &back() const
+    {
+        return entries.back();
+    }
+    void push_back(const readyEntry &entry)
+    {
+        if (entries.size() == entries.capacity() && head * 2 >= entries.size())
+        {
+            entries.erase(entries.begin(), entries.begin() + head);
+            head = 0;
+        }
+        entries.push_back(entry);
+    }
+    void pop_front()
+    {
+        head++;
+        if (empty())
+        {
+            clear();
+        }
+    }
+    void pop_back()
+    {
+        entries.pop_back();
+        if (empty())
+        {
+            clear();
+        }
+    }
+    void clear()
+    {
+        entries.clear();
+        head = 0;
+    }
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last)
+    {
+        entries.assign(first, last);
+        head = 0;
+    }
+};
+
+// Timings of a terminated process for the metrics export
+// A process arrives when it is loaded into memory, as in the scheduler report
+struct processMetrics
+{
+    long long processID;
+    int arrival;
+    int firstRun;
+    int completion;
+    long long waiting; // time spent ready but not running
+};
+
+// Ready queue of PCB addresses ordered by the scheduling policy
+// Round robin and MLFQ use FIFO buckets, the other policies a heap,
+// so every operation is O(1) or O(log n)
+struct scheduler
+{
+    int policy = SCHEDULE_ROUND_ROBIN;
+    const memoryWord *mainMemory = NULL;
+    processTable *processes = NULL;
+    readyFifo levels[MLFQ_LEVELS]; // round robin only uses level 0
+    patchableHeap<readyEntry, laterReadyEntry> heap;
+    long long nextSequence = 0;
+    hashIndex priorities; // PID -> priority, read from the priorities file
+
+    // Totals for the end of run report
+    long long completed = 0;
+    long long totalTurnaround = 0; // load to termination
+    long long totalResponse = 0;   // load to first run
+    vector<processMetrics> *finishedProcesses = NULL; // collects every terminated process when metrics are on
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+    size_t size() const
+    {
+        size_t count = heap.size();
+        for (int level = 0; level < MLFQ_LEVELS; level++)
+        {
+            count += levels[level].size();
+        }
+        return count;
+    }
+    processEntry &processAt(int startAddress)
+    {
+        return processes->entries[findProcessAt(*processes, startAddress)];
+    }
+    // Function to look up the priority of a process, 0 if the file does not list it
+    int priorityOf(long long processID) const
+    {
+        int priority = hashIndexFind(priorities, processID);
+        return priority == -1 ? 0 : priority;
+    }
+    void push(int startAddress, int readyTime)
+    {
+        if (policy == SCHEDULE_ROUND_ROBIN)
+        {
+            levels[0].push_back({0, 0, startAddress, readyTime});
+            return;
+        }
+        processEntry &process = processAt(startAddress);
+        if (policy == SCHEDULE_MLFQ)
+        {
+            levels[process.queueLevel].push_back({0, 0, startAddress, readyTime});
+            return;
+        }
+        long long key = process.priority;
+        if (policy == SCHEDULE_SJF || policy == SCHEDULE_SRTF)
+        {
+            key = (long long)process.program.size() - mainMemory[startAddress + 2];
+        }
+        heap.push({key, nextSequence++, startAddress, readyTime});
+    }
+    readyEntry pop()
+    {
+        readyEntry entry;
+        if (!heap.empty())
+        {
+            entry = heap.top();
+            heap.pop();
+            return entry;
+        }
+        int level = 0;
+        while (levels[level].empty())
+        {
+            level++;
+        }
+        entry = levels[level].front();
+        levels[level].pop_front();
+        return entry;
+    }
+    // Function to give up a ready process to another core
+    // FIFO policies give the entry that would run last, heap policies the next one
+    readyEntry steal()
+    {
+        readyEntry entry;
+        if (!heap.empty())
+        {
+            entry = heap.top();
+            heap.pop();
+            return entry;
+        }
+        int level = MLFQ_LEVELS - 1;
+        while (levels[level].empty())
+        {
+            level--;
+        }
+        entry = levels[level].back();
+        levels[level].pop_back();
+        return entry;
+    }
+    // Function to note that a process used its whole time slice
+    void preempted(int startAddress)
+    {
+        if (policy == SCHEDULE_MLFQ)
+        {
+            processEntry &process = processAt(startAddress);
+            process.queueLevel = min(process.queueLevel + 1, MLFQ_LEVELS - 1);
+        }
+    }
+    // Function to get the time slice of the process about to run
+    int timeSlice(int startAddress, int quantum)
+    {
+        if (policy == SCHEDULE_SJF)
+        {
+            return INT_MAX;
+        }
+        if (policy == SCHEDULE_MLFQ)
+        {
+            return quantum << processAt(startAddress).queueLevel;
+        }
+        return quantum;
+    }
+    // Function to follow a process whose PCB moved
+    void relocate(int from, int to)
+    {
+        for (readyEntry &entry : heap.entries())
+        {
+            entry.startAddress = entry.startAddress == from ? to : entry.startAddress;
+        }
+        for (int level = 0; level < MLFQ_LEVELS; level++)
+        {
+            for (readyEntry &entry : levels[level])
+            {
+                entry.startAddress = entry.startAddress == from ? to : entry.startAddress;
+            }
+        }
+    }
+    void finished(const processEntry &process)
+    {
+        completed++;
+        totalTurnaround += process.endTime - process.loadTime;
+        totalResponse += process.startTime - process.loadTime;
+        if (finishedProcesses != NULL)
+        {
+            finishedProcesses->push_back(
+                {process.processID, process.loadTime, process.startTime, process.endTime, process.waitingTime});
+        }
+    }
+};
+
+// Function to move processes whose IO has completed to the ready queue
+// Only entries that are due are popped from the heap; entries completing
+// in the same check are released in the order they entered IO
+void checkIOWaitingQueue(ioTimerQueue &ioWaitQueue, int &globalClock, scheduler &readyQueue, memoryWord *mainMemory,
+                         const processTable &processes)
+{
+    vector<IOWaitEntry> &completed = ioWaitQueue.completed;
+    completed.clear();
+    while (!ioWaitQueue.empty() && ioWaitQueue.nextCompletion() <= globalClock)
+    {
+        completed.push_back(ioWaitQueue.waiting.top());
+        ioWaitQueue.waiting.pop();
+    }
+    if (completed.size() > 1)
+    {
+        sort(completed.begin(), completed.end(),
+             [](const IOWaitEntry &a, const IOWaitEntry &b) { return a.sequence < b.sequence; });
+    }
+    for (const IOWaitEntry &entry : completed)
+    {
+        // globalClock += entry.ioCycles; // Update global clock
+        int base = entry.baseAddress;
+        long long processID = processes.entries[findProcessAt(processes, base)].processID;
+        mainMemory[base + 1] = 1; // Ready
+        readyQueue.push(base, globalClock);
+        logEvent(EVENT_IO_COMPLETE, globalClock, processID);
+    }
+}
+
+
+
+const size_t READ_BLOCK_SIZE = 1 << 20;
+const size_t LONGEST_TOKEN = 32; // refill before fewer bytes than this are left
+
+// Job file reader that parses integers straight out of large blocks of input
+// Regular files are memory mapped, pipes are read a block at a time
+struct jobReader
+{
+    int fd = -1;
+    char *mapping = NULL; // whole file when mapped
+    size_t mappingSize = 0;
+    vector<char> block;   // read buffer when not mapped
+    long long blockStart = 0; // input offset of the first byte in block
+    const char *cursor = NULL;
+    const char *end = NULL;
+    bool endOfInput = false; // nothing more can be read past end
+    bool failed = false;     // malformed or truncated input
+    long long jobsLeft = 0;  // jobs announced by the header and not parsed yet
+};
+
+// Function to open the job file, an empty path reads standard input
+bool openJobReader(jobReader &reader, const string &path)
+{
+    reader.fd = path.empty() ? 0 : open(path.c_str(), O_RDONLY);
+    if (reader.fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(reader.fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, reader.fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+            reader.mapping = (char *)mapping;
+            reader.mappingSize = info.st_size;
+            reader.cursor = reader.mapping;
+            reader.end = reader.mapping + reader.mappingSize;
+            reader.endOfInput = true;
+            return true;
+        }
+    }
+    reader.block.resize(READ_BLOCK_SIZE);
+    reader.cursor = reader.end = reader.block.data();
+    return true;
+}
+
+void closeJobReader(jobReader &reader)
+{
+    if (reader.mapping != NULL)
+    {
+        munmap(reader.mapping, reader.mappingSize);
+        reader.mapping = NULL;
+    }
+    if (reader.fd > 0)
+    {
+        close(reader.fd);
+    }
+    reader.fd = -1;
+}
+
+// Function to move the unparsed tail to the front of the block and read more after it
+void refillReader(jobReader &reader)
+{
+    reader.blockStart += reader.cursor - reader.block.data();
+    size_t left = reader.end - reader.cursor;
+    memmove(reader.block.data(), reader.cursor, left);
+    reader.cursor = reader.block.data();
+    reader.end = reader.cursor + left;
+    while (!reader.endOfInput && reader.end < reader.block.data() + reader.block.size())
+    {
+        ssize_t count = read(reader.fd, (char *)reader.end, reader.block.data() + reader.block.size() - reader.end);
+        if (count <= 0)
+        {
+            reader.endOfInput = true;
+        }
+        else
+        {
+            reader.end += count;
+        }
+    }
+}
+
+// Function to get the input offset of the next unparsed byte
+long long readerOffset(const jobReader &reader)
+{
+    if (reader.mapping != NULL)
+    {
+        return reader.cursor - reader.mapping;
+    }
+    return reader.blockStart + (reader.cursor - reader.block.data());
+}
+
+// Function to move the reader forward to an input offset
+// Mapped files jump there directly, pipes read and discard the bytes before it
+// Returns false if the input ends first
+bool seekJobReader(jobReader &reader, long long offset)
+{
+    if (reader.mapping != NULL)
+    {
+        if (offset > (long long)reader.mappingSize)
+        {
+            return false;
+        }
+        reader.cursor = reader.mapping + offset;
+        return true;
+    }
+    while (readerOffset(reader) < offset)
+    {
+        if (reader.cursor == reader.end)
+        {
+            if (reader.endOfInput)
+            {
+                return false;
+            }
+            refillReader(reader);
+            continue;
+        }
+        reader.cursor += min((long long)(reader.end - reader.cursor), offset - readerOffset(reader));
+    }
+    return true;
+}
+
+// Function to parse the next whitespace separated integer
+// Returns false at the end of input or on a malformed token
+bool readInteger(jobReader &reader, long long &value)
+{
+    for (;;)
+    {
+        while (reader.cursor < reader.end && (unsigned char)*reader.cursor <= ' ')
+        {
+            reader.cursor++;
+        }
+        if (!reader.endOfInput && (size_t)(reader.end - reader.cursor) < LONGEST_TOKEN)
+        {
+            refillReader(reader);
+            continue;
+        }
+        break;
+    }
+    if (reader.cursor == reader.end)
+    {
+        return false;
+    }
+    bool negative = *reader.cursor == '-';
+    if (negative)
+    {
+        reader.cursor++;
+    }
+    const char *digits = reader.cursor;
+    unsigned long long number = 0;
+    while (reader.cursor < reader.end && (unsigned)(*reader.cursor - '0') < 10)
+    {
+        number = number * 10 + (*reader.cursor - '0');
+        reader.cursor++;
+    }
+    if (reader.cursor == digits)
+    {
+        reader.failed = true;
+        return false;
+    }
+    value = negative ? -(long long)number : (long long)number;
+    return true;
+}
+
+bool readInteger(jobReader &reader, int &value)
+{
+    long long number;
+    if (!readInteger(reader, number))
+    {
+        return false;
+    }
+    value = (int)number;
+    return true;
+}
+
+// Function to parse the next job into a PCB
+// Returns false once every job announced by the header has been read
+// or if the input ends in the middle of a job
+bool readJob(jobReader &reader, PCB &newJob)
+{
+    if (reader.jobsLeft <= 0 || reader.failed)
+    {
+        return false;
+    }
+    if (!readInteger(reader, newJob.processID) || !readInteger(reader, newJob.maxMemoryNeeded) ||
+        !readInteger(reader, newJob.instructionSize))
+    {
+        reader.failed = true;
+        return false;
+    }
+
+    newJob.state = 1;
+    newJob.programCounter = 0;
+    newJob.cpuCyclesUsed = 0;
+    newJob.registerValue = 0;
+    newJob.startTime = -1;
+    newJob.endTime = -1;
+    newJob.memoryLimit = newJob.maxMemoryNeeded;
+
+    newJob.logicalMemory.clear();
+    for (int j = 0; j < newJob.instructionSize; j++)
+    {
+        int opcode;
+        if (!readInteger(reader, opcode))
+        {
+            reader.failed = true;
+            return false;
+        }
+        newJob.logicalMemory.push_back(opcode);
+        int operands = operandCount(opcode);
+        for (int k = 0; k < operands; k++)
+        {
+            int operand;
+            if (!readInteger(reader, operand))
+            {
+                reader.failed = true;
+                return false;
+            }
+            newJob.logicalMemory.push_back(operand);
+        }
+    }
+    reader.jobsLeft--;
+    return true;
+}
+
+// Function to read a priorities file made of "PID priority" pairs
+// Priorities must not be negative
+// Returns false if the file cannot be opened or holds a malformed pair
+bool readPriorities(const string &path, hashIndex &priorities)
+{
+    jobReader reader;
+    if (path.empty() || !openJobReader(reader, path))
+    {
+        return false;
+    }
+    long long processID;
+    int priority;
+    while (readInteger(reader, processID))
+    {
+        if (!readInteger(reader, priority) || priority < 0)
+        {
+            closeJobReader(reader);
+            return false;
+        }
+        hashIndexInsert(priorities, processID, priority);
+    }
+    closeJobReader(reader);
+    return !reader.failed;
+}
+
+// New job queue that parses jobs from the input only when they are needed
+// With a lookahead of 1 only the job at the head of the queue is held in memory
+// Parsed jobs sit in a ring of records that are reused once their job is
+// loaded, logical memory buffer included, so parsing allocates nothing
+// after the first few jobs
+// With backfilling the first window waiting jobs are also indexed by the
+// memory they need, and jobs behind the head may be loaded out of order;
+// those are marked taken and skipped once the head reaches them
+struct jobQueue
+{
+    vector<PCB> parsed; // ring of job records
+    size_t head = 0;    // record of the oldest parsed job
+    size_t parsedCount = 0;
+    long long poppedJobs = 0; // jobs that have left the ring, the input position of the head
+    jobReader *reader = NULL;
+    size_t lookahead = 1;
+    const vector<PCB> *jobs = NULL; // jobs parsed up front and shared between simulations
+    size_t nextJob = 0;
+
+    size_t window = 0;       // waiting jobs considered for backfilling, 0 loads jobs in input order only
+    int backfillWait = 0;    // cycles a blocked head waits before memory is reserved for it, 0 for never
+    vector<char> taken;      // taken[i] is set once waiting job i (0 = head) has been loaded
+    long long takenCount = 0;
+    vector<pair<int, long long>> bySize; // (memory needed, -input position) of the indexed jobs, ascending
+    long long indexedEnd = 0; // input position one past the last indexed job
+    long long blockedJob = -1; // input position of the blocked head, -1 if the head is not blocked
+    int blockedSince = 0;
+    bool reserved = false;   // memory is reserved for the blocked head
+    long long backfilled = 0;  // jobs loaded ahead of a blocked head
+    long long reservations = 0;
+
+    // Function to get the i-th parsed job, 0 is the oldest
+    const PCB &parsedJob(size_t i) const
+    {
+        return parsed[(head + i) % parsed.size()];
+    }
+    // Function to get the record the next parsed job goes into
+    // The ring only grows when every record holds a job
+    PCB &nextRecord()
+    {
+        if (parsedCount == parsed.size())
+        {
+            rotate(parsed.begin(), parsed.begin() + head, parsed.end());
+            head = 0;
+            parsed.emplace_back();
+        }
+        return parsed[(head + parsedCount) % parsed.size()];
+    }
+
+    // Function to parse jobs until the lookahead (or the given count) is
+    // filled or the input is exhausted
+    void fill(size_t count = 0)
+    {
+        while (parsedCount < max(lookahead, count) && reader != NULL)
+        {
+            if (!readJob(*reader, nextRecord()))
+            {
+                if (reader->failed)
+                {
+                    cerr << "Error: job input is malformed or truncated, remaining jobs ignored." << endl;
+                }
+                reader = NULL;
+                break;
+            }
+            parsedCount++;
+        }
+    }
+
+    bool empty()
+    {
+        if (jobs != NULL)
+        {
+            return nextJob == jobs->size();
+        }
+        fill();
+        return parsedCount == 0;
+    }
+    const PCB &front()
+    {
+        if (jobs != NULL)
+        {
+            return (*jobs)[nextJob];
+        }
+        fill();
+        return parsed[head];
+    }
+    // Function to remove the head job, and any taken jobs right behind it
+    void pop()
+    {
+        unindex(0);
+        do
+        {
+            if (jobs != NULL)
+            {
+                nextJob++;
+            }
+            else
+            {
+                head = (head + 1) % parsed.size();
+                parsedCount--;
+                poppedJobs++;
+            }
+            if (!taken.empty())
+            {
+                takenCount -= taken[0];
+                taken.erase(taken.begin());
+            }
+        } while (!taken.empty() && taken[0]);
+    }
+    // Function to count the jobs not loaded yet, including those not parsed
+    size_t pending() const
+    {
+        if (jobs != NULL)
+        {
+            return jobs->size() - nextJob - takenCount;
+        }
+        return parsedCount + (reader != NULL ? reader->jobsLeft : 0) - takenCount;
+    }
+
+    // Function to get the input position of the head job
+    long long headPosition() const
+    {
+        return jobs != NULL ? (long long)nextJob : poppedJobs;
+    }
+    // Function to check that waiting job i exists, parsing up to it if needed
+    bool hasWaiting(size_t i)
+    {
+        if (jobs != NULL)
+        {
+            return nextJob + i < jobs->size();
+        }
+        fill(i + 1);
+        return i < parsedCount;
+    }
+    // Function to get waiting job i, 0 is the head
+    const PCB &waiting(size_t i) const
+    {
+        return jobs != NULL ? (*jobs)[nextJob + i] : parsedJob(i);
+    }
+    // Function to load waiting job i out of order, i must not be 0
+    void take(size_t i)
+    {
+        unindex(i);
+        if (taken.size() <= i)
+        {
+            taken.resize(i + 1, 0);
+        }
+        taken[i] = 1;
+        takenCount++;
+    }
+    // Function to add the jobs of the backfill window to the size index
+    void indexWindow()
+    {
+        long long first = headPosition();
+        for (long long position = max(indexedEnd, first);
+             position < first + (long long)window && hasWaiting(position - first); position++)
+        {
+            size_t i = position - first;
+            if (i >= taken.size() || !taken[i])
+            {
+                pair<int, long long> key = {waiting(i).maxMemoryNeeded, -position};
+                bySize.insert(lower_bound(bySize.begin(), bySize.end(), key), key);
+            }
+            indexedEnd = position + 1;
+        }
+    }
+    // Function to drop waiting job i from the size index
+    void unindex(size_t i)
+    {
+        long long position = headPosition() + i;
+        if (position >= indexedEnd)
+        {
+            return;
+        }
+        pair<int, long long> key = {waiting(i).maxMemoryNeeded, -position};
+        auto entry = lower_bound(bySize.begin(), bySize.end(), key);
+        if (entry != bySize.end() && *entry == key)
+        {
+            bySize.erase(entry);
+        }
+    }
+};
+
+// Function to place a job in one contiguous block
+// Returns the process slot or -1 if no free block is large enough
+int loadContiguousJob(const PCB &newJob, memoryWord *mainMemory, memoryAllocator &memoryList, processTable &processes)
+{
+    int pcbSize = PCB_SIZE;
+    int totalSize = pcbSize + newJob.maxMemoryNeeded;
+
+    // Allocate the block, it is split if it's larger than needed
+    int block = allocateBlock(memoryList, newJob.processID, totalSize);
+    if (block == -1)
+    {
+        return -1;
+    }
+    int startAddress = memoryList.blocks[block].startingAddress;
+    int slot = addProcess(processes, newJob.processID, block, startAddress);
+
+    // The job record is left untouched, it is reused or shared
+    int instructionBase = startAddress + pcbSize;
+    int dataBase = instructionBase + newJob.instructionSize;
+
+    // Store PCB fields
+    mainMemory[startAddress] = (int)newJob.processID; // low 32 bits, the process table keeps the full PID
+    mainMemory[startAddress+ 1] = 1; // Ready
+    mainMemory[startAddress+ 2] = newJob.programCounter;
+    mainMemory[startAddress + 3] = instructionBase;
+    mainMemory[startAddress + 4] = dataBase;
+    mainMemory[startAddress+ 5] = newJob.memoryLimit;
+    mainMemory[startAddress+ 6] = newJob.cpuCyclesUsed;
+    mainMemory[startAddress+ 7] = newJob.registerValue;
+    mainMemory[startAddress+ 8] = newJob.maxMemoryNeeded;
+    mainMemory[startAddress + 9] = startAddress;
+
+    // Load instructions
+    int j = 0;
+    for (int i = 0; i < newJob.instructionSize; i++)
+    {
+        mainMemory[instructionBase + i] = newJob.logicalMemory[j];
+        int operands = operandCount(newJob.logicalMemory[j]);
+        j += operands > 1 ? operands + 1 : 2;
+    }
+
+    // Load data
+    j = 0;
+    for (int i = dataBase; i < dataBase + newJob.maxMemoryNeeded - 1 && j < newJob.logicalMemory.size(); i++)
+    {
+        int operands = operandCount(newJob.logicalMemory[j]);
+        if (operands > 0)
+        {
+            for (int k = 0; k < operands; k++)
+            {
+                mainMemory[i + k] = newJob.logicalMemory[j + 1 + k];
+            }
+            i += operands - 1;
+            j += operands + 1;
+        }
+    }
+    decodeProgram(mainMemory, NULL, instructionBase, newJob.instructionSize, newJob.maxMemoryNeeded,
+                  processes.entries[slot].dataOffsets, processes.entries[slot].program, processes.entries[slot].runs);
+    return slot;
+}
+
+// Function to build the logical image of a job: the PCB, headerSize - PCB_SIZE
+// words left -1 for the caller, then the instructions and their operands
+// Instruction and data bases in the PCB are logical addresses
+void buildLoadImage(const PCB &newJob, int headerSize, int startAddress, vector<int> &image)
+{
+    int totalSize = headerSize + newJob.maxMemoryNeeded;
+    int instructionBase = headerSize;
+    int dataBase = instructionBase + newJob.instructionSize;
+    image.assign(totalSize, -1);
+    image[0] = (int)newJob.processID;
+    image[1] = 1; // Ready
+    image[2] = newJob.programCounter;
+    image[3] = instructionBase;
+    image[4] = dataBase;
+    image[5] = newJob.memoryLimit;
+    image[6] = newJob.cpuCyclesUsed;
+    image[7] = newJob.registerValue;
+    image[8] = newJob.maxMemoryNeeded;
+    image[9] = startAddress;
+
+    int j = 0;
+    for (int i = 0; i < newJob.instructionSize; i++)
+    {
+        image[instructionBase + i] = newJob.logicalMemory[j];
+        int operands = operandCount(newJob.logicalMemory[j]);
+        j += operands > 1 ? operands + 1 : 2;
+    }
+    // Operands that would run past the job's memory are dropped
+    j = 0;
+    for (int i = dataBase; i < totalSize && j < (int)newJob.logicalMemory.size(); i++)
+    {
+        int operands = operandCount(newJob.logicalMemory[j]);
+        if (operands > 0)
+        {
+            for (int k = 0; k < operands && i + k < totalSize; k++)
+            {
+                image[i + k] = newJob.logicalMemory[j + 1 + k];
+            }
+            i += operands - 1;
+            j += operands + 1;
+        }
+    }
+}
+
+// Function to place a job in up to MAX_SEGMENTS non-contiguous blocks
+// A single block is used when one is large enough, free blocks are coalesced
+// before giving up on that. Otherwise the largest free blocks are combined,
+// the first of them must hold the PCB and segment table
+// so both stay at the start address the queues refer to
+// Instruction and data bases in the PCB are logical addresses
+// Returns the process slot or -1 if the free blocks cannot hold the job
+int loadSegmentedJob(const PCB &newJob, memoryWord *mainMemory, memoryAllocator &memoryList, processTable &processes)
+{
+    int totalSize = SEGMENTED_HEADER_SIZE + newJob.maxMemoryNeeded;
+    int segments[MAX_SEGMENTS] = {};
+    int lengths[MAX_SEGMENTS] = {};
+    int segmentCount = 0;
+
+    int block = findFreeBlockCoalescing(memoryList, totalSize);
+    if (block != -1)
+    {
+        segments[0] = block;
+        lengths[0] = totalSize;
+        segmentCount = 1;
+    }
+    else
+    {
+        int candidates[MAX_SEGMENTS];
+        int found = largestFreeBlocks(memoryList, candidates, MAX_SEGMENTS);
+        if (found == 0 || memoryList.blocks[candidates[0]].size < SEGMENTED_HEADER_SIZE)
+        {
+            return -1;
+        }
+        int remaining = totalSize;
+        for (int i = 0; i < found && remaining > 0; i++)
+        {
+            segments[segmentCount] = candidates[i];
+            lengths[segmentCount] = min(memoryList.blocks[candidates[i]].size, remaining);
+            remaining -= lengths[segmentCount];
+            segmentCount++;
+        }
+        if (remaining > 0)
+        {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < segmentCount; i++)
+    {
+        claimBlock(memoryList, segments[i], newJob.processID, lengths[i]);
+    }
+    int startAddress = memoryList.blocks[segments[0]].startingAddress;
+    int slot = addProcess(processes, newJob.processID, segments[0], startAddress);
+    processEntry &process = processes.entries[slot];
+    process.blockCount = segmentCount;
+    for (int i = 1; i < segmentCount; i++)
+    {
+        process.blocks[i] = segments[i];
+    }
+    process.segmentTable = startAddress + PCB_SIZE;
+
+    int instructionBase = SEGMENTED_HEADER_SIZE;
+
+    // Build the logical image: PCB, segment table, instructions, data
+    vector<int> &image = processes.loadImage;
+    buildLoadImage(newJob, SEGMENTED_HEADER_SIZE, startAddress, image);
+    int *segmentTable = image.data() + PCB_SIZE;
+    segmentTable[0] = 2 * segmentCount;
+    for (int i = 0; i < segmentCount; i++)
+    {
+        segmentTable[1 + i * 2] = memoryList.blocks[segments[i]].startingAddress;
+        segmentTable[1 + i * 2 + 1] = lengths[i];
+    }
+
+    copyProcessToMemory(image.data(), totalSize, segmentTable, mainMemory);
+    buildTranslation(process.translation, segmentTable);
+    decodeProgram(mainMemory, &process.translation, instructionBase, newJob.instructionSize,
+                  newJob.maxMemoryNeeded, process.dataOffsets, process.program, process.runs);
+    return slot;
+}
+
+// Function to load a job into paged memory
+// Only page 0, holding the PCB and the first instructions, gets a frame; the
+// other pages are written to swap and faulted in when the job touches them.
+// Two frames are always left unpinned so a running process can hold the
+// page of its next instruction and the page it loads from or stores to
+// Returns the process slot or -1 if no frame can be pinned for the PCB
+int loadPagedJob(const PCB &newJob, memoryWord *mainMemory, memoryAllocator &memoryList, processTable &processes,
+                 int clock)
+{
+    pagingState &paging = *memoryList.paging;
+    if (paging.pinnedFrames + 1 > paging.frames - 2)
+    {
+        return -1;
+    }
+    int block = allocateFrame(paging, memoryList, mainMemory, processes, newJob.processID, clock);
+    if (block == -1)
+    {
+        return -1;
+    }
+    paging.pinnedFrames++;
+    int startAddress = memoryList.blocks[block].startingAddress;
+    int slot = addProcess(processes, newJob.processID, block, startAddress);
+    processEntry &process = processes.entries[slot];
+
+    vector<int> &image = processes.loadImage;
+    buildLoadImage(newJob, PCB_SIZE, startAddress, image);
+    int totalSize = image.size();
+    int pageSize = paging.pageSize;
+    vector<pageEntry> &pages = process.translation.pages;
+    pages.assign((totalSize + pageSize - 1) / pageSize, pageEntry());
+    pages[0].frame = startAddress;
+    pages[0].block = block;
+    for (int i = 0; i < min(pageSize, totalSize); i++)
+    {
+        mainMemory[startAddress + i] = image[i];
+    }
+    for (int page = 1; page < (int)pages.size(); page++)
+    {
+        int first = page * pageSize;
+        int last = min(first + pageSize, totalSize);
+        if (all_of(image.begin() + first, image.begin() + last, [](int word) { return word == -1; }))
+        {
+            continue;
+        }
+        pages[page].swapSlot = allocateSwapSlot(paging);
+        memoryWord *words = swapPage(paging, pages[page].swapSlot);
+        for (int i = 0; i < pageSize; i++)
+        {
+            words[i] = first + i < last ? image[first + i] : -1;
+        }
+    }
+    process.translation.paging = &paging;
+    decodeProgram(mainMemory, &process.translation, PCB_SIZE, newJob.instructionSize, newJob.maxMemoryNeeded,
+                  process.dataOffsets, process.program, process.runs);
+    return slot;
+}
+
+// Function to load a job with the loader of the memory mode
+// Returns the process slot or -1 if the job does not fit
+int loadJob(const PCB &newJob, memoryWord *mainMemory, memoryAllocator &memoryList, processTable &processes,
+            int clock)
+{
+    if (memoryList.paging != NULL)
+    {
+        return loadPagedJob(newJob, mainMemory, memoryList, processes, clock);
+    }
+    return memoryList.segmented ? loadSegmentedJob(newJob, mainMemory, memoryList, processes)
+                                : loadContiguousJob(newJob, mainMemory, memoryList, processes);
+}
+
+// Function to make a newly loaded job ready and log where it went
+void admitJob(const PCB &newJob, int slot, scheduler &readyQueue, const memoryAllocator &memoryList,
+              processTable &processes, int globalClock)
+{
+    int headerSize = memoryList.segmented ? SEGMENTED_HEADER_SIZE : PCB_SIZE;
+    processes.entries[slot].loadTime = globalClock;
+    processes.entries[slot].priority = readyQueue.priorityOf(newJob.processID);
+    const processEntry &process = processes.entries[slot];
+    readyQueue.push(process.mainMemoryBase, globalClock);
+    logEvent(EVENT_JOB_LOADED, globalClock, newJob.processID,
+             {process.mainMemoryBase, newJob.maxMemoryNeeded + headerSize});
+    for (int i = 0; process.blockCount > 1 && i < process.blockCount; i++)
+    {
+        const memoryBlock &segment = memoryList.blocks[process.blocks[i]];
+        logEvent(EVENT_SEGMENT_ALLOCATED, globalClock, newJob.processID, {i, segment.startingAddress, segment.size});
+    }
+}
+
+// Function to split the block of a contiguous process into pages that can be shared copy-on-write
+// The process keeps every page and is addressed logically from then on, so
+// the bases in its PCB and its decoded program are rewritten for the page table
+void sharePages(sharingState &sharing, memoryAllocator &memoryList, memoryWord *mainMemory, processEntry &process)
+{
+    int base = process.mainMemoryBase;
+    int size = memoryList.blocks[process.blocks[0]].size;
+    vector<pageEntry> &pages = process.translation.pages;
+    pages.clear();
+    for (int offset = 0, index = process.blocks[0]; offset < size; offset += sharing.pageSize)
+    {
+        int next = size - offset > sharing.pageSize ? splitBlock(memoryList, index, sharing.pageSize) : -1;
+        memoryList.blocks[index].sharers = 1;
+        pages.push_back({base + offset, index});
+        index = next;
+    }
+    int instructionSize = mainMemory[base + 4] - mainMemory[base + 3];
+    mainMemory[base + 3] = PCB_SIZE;
+    mainMemory[base + 4] = PCB_SIZE + instructionSize;
+    process.translation.sharing = &sharing;
+    process.translation.sharedSize = size;
+    decodeProgram(mainMemory, &process.translation, PCB_SIZE, instructionSize, mainMemory[base + 8],
+                  process.dataOffsets, process.program, process.runs);
+}
+
+// Function to fork a process whose PCB is saved, the child is made ready behind it
+// The child gets a copy of page 0 and shares every other page of the parent.
+// It resumes after the Fork with a register of 0 and no CPU cycles used, and
+// the parent's register gets the child's PID. A fork fails, leaving the
+// parent's register -1, if the child's PID is negative or resident, if no
+// block is free for the child's page 0, or outside the contiguous memory mode
+// Returns false if the fork failed
+bool forkProcess(long long childID, int parentSlot, memoryWord *mainMemory, memoryAllocator &memoryList,
+                 processTable &processes, scheduler &readyQueue, int clock)
+{
+    sharingState &sharing = *memoryList.sharing;
+    long long parentID = processes.entries[parentSlot].processID;
+    int parentBase = processes.entries[parentSlot].mainMemoryBase;
+    int firstPage = min(sharing.pageSize, PCB_SIZE + mainMemory[parentBase + 8]);
+    if (memoryList.segmented || memoryList.paging != NULL || childID < 0 || findProcess(processes, childID) != -1 ||
+        findFreeBlockCoalescing(memoryList, firstPage) == -1)
+    {
+        mainMemory[parentBase + 7] = -1;
+        sharing.counters.failedForks++;
+        logEvent(EVENT_FORK_FAILED, clock, parentID, {childID});
+        return false;
+    }
+    if (processes.entries[parentSlot].translation.sharing == NULL)
+    {
+        sharePages(sharing, memoryList, mainMemory, processes.entries[parentSlot]);
+    }
+    int block = allocateBlock(memoryList, childID, firstPage);
+    int childBase = memoryList.blocks[block].startingAddress;
+    memoryList.blocks[block].sharers = 1;
+    memcpy(mainMemory + childBase, mainMemory + parentBase, firstPage * sizeof(memoryWord));
+    mainMemory[childBase] = (int)childID; // low 32 bits, the process table keeps the full PID
+    mainMemory[childBase + 6] = 0;
+    mainMemory[childBase + 7] = 0;
+    mainMemory[childBase + 9] = childBase;
+    mainMemory[parentBase + 7] = (int)childID;
+
+    int slot = addProcess(processes, childID, block, childBase);
+    const processEntry &parent = processes.entries[parentSlot]; // the table may have grown
+    processEntry &child = processes.entries[slot];
+    child.translation.sharing = &sharing;
+    child.translation.sharedSize = parent.translation.sharedSize;
+    child.translation.pages = parent.translation.pages;
+    child.translation.pages[0] = {childBase, block};
+    for (size_t page = 1; page < child.translation.pages.size(); page++)
+    {
+        memoryBlock &shared = memoryList.blocks[child.translation.pages[page].block];
+        shared.sharers++;
+        sharing.counters.sharedWords += shared.size;
+    }
+    sharing.counters.peakSharedWords = max(sharing.counters.peakSharedWords, sharing.counters.sharedWords);
+    sharing.counters.forks++;
+    child.dataOffsets = parent.dataOffsets;
+    child.program = parent.program;
+    child.runs = parent.runs;
+    child.loadTime = clock;
+    child.priority = readyQueue.priorityOf(childID);
+    readyQueue.push(childBase, clock);
+    logEvent(EVENT_FORKED, clock, parentID, {childID});
+    return true;
+}
+
+// Function to get the most memory a job could be given right now, header excluded
+// In segmented mode that is what the largest free blocks hold together. A
+// paged job needs one frame whatever its size, so when the head does not
+// get one no job behind it can either
+int backfillCapacity(const memoryAllocator &memoryList)
+{
+    if (memoryList.paging != NULL)
+    {
+        return 0;
+    }
+    if (!memoryList.segmented)
+    {
+        return largestFreeSize(memoryList) - PCB_SIZE;
+    }
+    int candidates[MAX_SEGMENTS];
+    int found = largestFreeBlocks(memoryList, candidates, MAX_SEGMENTS);
+    int capacity = 0;
+    for (int i = 0; i < found; i++)
+    {
+        capacity += memoryList.blocks[candidates[i]].size;
+    }
+    return capacity - SEGMENTED_HEADER_SIZE;
+}
+
+// Function to load waiting jobs past a head job that does not fit
+// Candidates come from the size index of the backfill window, largest first
+// (earliest first among equal sizes), so the free blocks are filled as
+// tightly as possible. Once the head has been blocked for backfillWait
+// cycles no job may pass it any more, and memory freed from then on is
+// left for the head
+void backfillJobs(jobQueue &newJobQueue, scheduler &readyQueue, memoryWord *mainMemory,
+                  memoryAllocator &memoryList, processTable &processes, int globalClock)
+{
+    long long head = newJobQueue.headPosition();
+    if (newJobQueue.blockedJob != head)
+    {
+        newJobQueue.blockedJob = head;
+        newJobQueue.blockedSince = globalClock;
+        newJobQueue.reserved = false;
+    }
+    if (newJobQueue.reserved)
+    {
+        return;
+    }
+    if (newJobQueue.backfillWait > 0 && globalClock - newJobQueue.blockedSince >= newJobQueue.backfillWait)
+    {
+        newJobQueue.reserved = true;
+        newJobQueue.reservations++;
+        logEvent(EVENT_MEMORY_RESERVED, globalClock, newJobQueue.front().processID,
+                 {globalClock - newJobQueue.blockedSince});
+        return;
+    }
+
+    newJobQueue.indexWindow();
+    vector<pair<int, long long>> &bySize = newJobQueue.bySize;
+    int capacity = backfillCapacity(memoryList);
+    while (capacity > 0)
+    {
+        auto candidate = upper_bound(bySize.begin(), bySize.end(), make_pair(capacity, LLONG_MAX));
+        if (candidate == bySize.begin())
+        {
+            break;
+        }
+        --candidate;
+        size_t i = -candidate->second - head;
+        if (i == 0)
+        { // the head is only loaded in order
+            capacity = candidate->first - 1;
+            continue;
+        }
+        const PCB &newJob = newJobQueue.waiting(i);
+        if (findProcess(processes, newJob.processID) != -1)
+        {
+            logEvent(EVENT_DUPLICATE_JOB, globalClock, newJob.processID);
+            newJobQueue.take(i);
+            continue;
+        }
+        int slot = loadJob(newJob, mainMemory, memoryList, processes, globalClock);
+        if (slot == -1)
+        { // the free blocks can hold this many words but not in a layout the job can use
+            capacity = candidate->first - 1;
+            continue;
+        }
+        admitJob(newJob, slot, readyQueue, memoryList, processes, globalClock);
+        logEvent(EVENT_JOB_BACKFILLED, globalClock, newJob.processID, {newJobQueue.front().processID});
+        newJobQueue.take(i);
+        newJobQueue.backfilled++;
+        capacity = backfillCapacity(memoryList);
+    }
+}
+
+// Function to load jobs into memory
+// This function checks if there is sufficient memory available
+// and loads the job into memory if possible
+// If not, it attempts to coalesce memory blocks
+// and retry loading the job
+// If still not possible (in segmented mode, no set of free blocks can
+// hold it), the job is left in the new job queue until memory becomes
+// available. With a backfill window, smaller jobs behind it may be
+// loaded in the meantime
+void loadJobsToMemory(jobQueue &newJobQueue, scheduler &readyQueue, memoryWord *mainMemory,
+                      int maxMemory, memoryAllocator &memoryList, processTable &processes, int globalClock)
+{
+    while (!newJobQueue.empty())
+    {
+
+       // printList(memoryList); // Debug output
+
+        const PCB &newJob = newJobQueue.front();
+
+        if (findProcess(processes, newJob.processID) != -1)
+        {
+            logEvent(EVENT_DUPLICATE_JOB, globalClock, newJob.processID);
+            newJobQueue.pop();
+            continue;
+        }
+
+        int slot = loadJob(newJob, mainMemory, memoryList, processes, globalClock);
+        if (slot == -1)
+        {
+            logEvent(EVENT_NO_MEMORY, globalClock, newJob.processID);
+            if (coalesceFreeBlocks(memoryList))
+            {
+                slot = loadJob(newJob, mainMemory, memoryList, processes, globalClock);
+            }
+            if (slot == -1)
+            {
+                logEvent(EVENT_JOB_WAITING, globalClock, newJob.processID);
+                if (newJobQueue.window > 0)
+                {
+                    backfillJobs(newJobQueue, readyQueue, mainMemory, memoryList, processes, globalClock);
+                }
+                break;
+            }
+            logEvent(EVENT_MEMORY_COALESCED, globalClock, newJob.processID);
+        }
+        admitJob(newJob, slot, readyQueue, memoryList, processes, globalClock);
+        newJobQueue.pop();
+    }
+}
+// Function to print the contents of the new job queue
+// This function is used for debugging purposes
+void printNewJobQueue(const jobQueue &newJobQueue) {
+    flushLog();
+    cout << "New Job Queue Contents:" << endl;
+    cout << "Total Jobs: " << newJobQueue.parsedCount << endl;
+    
+    for (size_t jobIndex = 0; jobIndex < newJobQueue.parsedCount; jobIndex++) {
+        const PCB &job = newJobQueue.parsedJob(jobIndex);
+        
+        cout << "Process ID: " << job.processID << endl;
+        cout << "  Memory Needed: " << job.maxMemoryNeeded << endl;
+        cout << "  Instruction Size: " << job.instructionSize << endl;
+        cout << "  Logical Memory Contents:" << endl;
+        
+        // Print logical memory contents
+        for (size_t i = 0; i < job.logicalMemory.size(); ) {
+            int opcode = job.logicalMemory[i];
+            cout << "    Opcode: " << opcode;
+            
+            switch (opcode) {
+                case 1: // Compute
+                    cout << " (Compute): Iterations = " << job.logicalMemory[i+1] 
+                         << ", Cycles = " << job.logicalMemory[i+2] << endl;
+                    i += 3;
+                    break;
+                case 2: // Print
+                    cout << " (Print): IO Cycles = " << job.logicalMemory[i+1] << endl;
+                    i += 2;
+                    break;
+                case 3: // Store
+                    cout << " (Store): Value = " << job.logicalMemory[i+1] 
+                         << ", Address = " << job.logicalMemory[i+2] << endl;
+                    i += 3;
+                    break;
+                case 4: // Load
+                    cout << " (Load): Address = " << job.logicalMemory[i+1] << endl;
+                    i += 2;
+                    break;
+                case 5: // Fork
+                    cout << " (Fork): Child PID = " << job.logicalMemory[i+1] << endl;
+                    i += 2;
+                    break;
+                case 6: // Fill
+                    cout << " (Fill): Value = " << job.logicalMemory[i+1]
+                         << ", Address = " << job.logicalMemory[i+2]
+                         << ", Count = " << job.logicalMemory[i+3] << endl;
+                    i += 4;
+                    break;
+                case 7: // Copy
+                    cout << " (Copy): Source = " << job.logicalMemory[i+1]
+                         << ", Destination = " << job.logicalMemory[i+2]
+                         << ", Count = " << job.logicalMemory[i+3] << endl;
+                    i += 4;
+                    break;
+                case 8: // Sum
+                    cout << " (Sum): Address = " << job.logicalMemory[i+1]
+                         << ", Count = " << job.logicalMemory[i+2] << endl;
+                    i += 3;
+                    break;
+                default:
+                    cout << " (Unknown Opcode)" << endl;
+                    i++;
+                    break;
+            }
+        }
+        cout << endl;
+    }
+}
+// Function to find the word behind a logical address of a segmented, paged or forked process
+// A paged process faults the page in, a forked process writing to a shared page copies it first
+// Returns the physical address, or -1 if no memory backs the word
+int translatedWord(memoryWord *mainMemory, memoryAllocator &memoryList, processTable &processes, int slot,
+                   int address, bool write, int &clock)
+{
+    segmentTranslation &translation = processes.entries[slot].translation;
+    if (translation.paging != NULL)
+    {
+        return pageAddress(*translation.paging, memoryList, mainMemory, processes, slot, address, write, clock);
+    }
+    if (translation.sharing == NULL)
+    {
+        return translateAddress(translation, address);
+    }
+    if (write)
+    {
+        return writableAddress(*translation.sharing, memoryList, mainMemory, processes.entries[slot], address, clock);
+    }
+    int pageSize = translation.sharing->pageSize;
+    return address < translation.sharedSize ? translation.pages[address / pageSize].frame + address % pageSize : -1;
+}
+
+// Function to execute the CPU instructions
+// It updates the program counter, CPU cycles used, and register value
+// It also handles I/O interrupts and memory management
+// The function takes the starting address of the process in memory
+// and updates the main memory, global clock, and other parameters  
+void executeCPU(int startAddress, memoryWord *mainMemory, int CPUAllocated, int &globalClock,
+                ioTimerQueue &ioWaitQueue, scheduler &readyQueue, int &totalCpuTime, processTable &processes, memoryAllocator &memoryList, int maxMemory, jobQueue &newJobQueue,
+                bulkMemoryState &bulk)
+{
+    int slot = findProcessAt(processes, startAddress);
+    processEntry &process = processes.entries[slot];
+    long long processID = process.processID;
+    int programCounter = mainMemory[startAddress + 2];
+    // cout<< "Prog counter: " <<  programCounter << endl;
+    int instructionBase = mainMemory[startAddress + 3];
+    // cout<< "Instruction Base1: " <<  instructionBase << endl;
+    int dataBase = mainMemory[startAddress + 4];
+    int memoryLimit = mainMemory[startAddress + 5];
+    int cpuCyclesUsed = mainMemory[startAddress + 6];
+    int registerValue = mainMemory[startAddress + 7];
+
+    int maxMemoryNeeded = mainMemory[startAddress + 8];
+    int mainMemoryBase = mainMemory[startAddress + 9];
+
+    if (process.startTime == -1)
+    {
+        process.startTime = globalClock;
+    }
+    mainMemory[startAddress + 1] = 2; // Running state
+    int burstCycles = 0;
+    int instructionSize = dataBase - instructionBase;
+    const microOp *program = process.program.data(); // decoded at load time
+    pagingState *paging = process.translation.paging;
+    segmentTranslation *translation =
+        process.segmentTable == -1 && process.translation.pages.empty() ? NULL : &process.translation;
+    const microOp *op;
+    // An instruction's operands are found by stepping past the opcodes before it,
+    // and the steps already taken in this time slice are not taken again: after
+    // a Store changes the operand count of an opcode before the running one, the
+    // rest of the slice reads its operands this far before where the rebuilt
+    // table puts them, and those instructions are decoded as they are fetched
+    int operandShift = 0;
+    microOp shiftedOp;
+
+    // Each handler ends by dispatching the next micro-op itself
+#if THREADED_DISPATCH
+    static void *const dispatchTable[] = {&&invalidOp, &&computeOp, &&printOp, &&storeOp,
+                                          &&storeErrorOp, &&loadOp, &&loadErrorOp,
+                                          &&storeTranslatedOp, &&loadTranslatedOp, &&storePagedOp,
+                                          &&loadPagedOp, &&storeSharedOp, &&loadSharedOp, &&forkOp,
+                                          &&fillOp, &&copyOp, &&sumOp, &&fillTranslatedOp,
+                                          &&copyTranslatedOp, &&sumTranslatedOp, &&bulkErrorOp};
+#define DISPATCH_NEXT()                                                          \
+    do                                                                           \
+    {                                                                            \
+        if (programCounter >= instructionSize || burstCycles >= CPUAllocated)    \
+            goto burstEnd;                                                       \
+        op = &program[programCounter];                                           \
+        if (paging != NULL || operandShift != 0)                                 \
+            goto fetch;                                                          \
+        goto *dispatchTable[op->kind];                                           \
+    } while (0)
+#define MICRO_OP(kind, label) label:
+    DISPATCH_NEXT();
+#else
+#define DISPATCH_NEXT() goto dispatch
+#define MICRO_OP(kind, label) case kind:
+dispatch:
+    if (programCounter >= instructionSize || burstCycles >= CPUAllocated)
+        goto burstEnd;
+    op = &program[programCounter];
+    if (paging != NULL || operandShift != 0)
+        goto fetch;
+execute:
+    switch (op->kind)
+    {
+#endif
+// Preempt the process once its time slice is used up
+#define END_OF_INSTRUCTION()                                                     \
+    do                                                                           \
+    {                                                                            \
+        if (burstCycles >= CPUAllocated && programCounter < instructionSize)     \
+            goto timeOut;                                                        \
+        DISPATCH_NEXT();                                                         \
+    } while (0)
+
+    MICRO_OP(MICRO_COMPUTE, computeOp)
+    { // Compute: 1 iterations cycles
+        if (op->value < 0 || paging != NULL || operandShift != 0)
+        { // a paged process references the page of every instruction it fetches, and
+          // the decoded run does not hold the operands of a shifted slice
+            logEvent(EVENT_COMPUTE, globalClock, processID);
+            cpuCyclesUsed += op->value;
+            globalClock += op->value;
+            burstCycles += op->value;
+            programCounter += 1;
+            END_OF_INSTRUCTION();
+        }
+        // The run of Computes starting here is resolved in one step: it ends
+        // after the Compute that uses up the time slice, or at the first other
+        // instruction, whose barrier cost stops the search right after it
+        if (process.runs.stale)
+        {
+            buildComputeRuns(process.program, process.runs);
+        }
+        const long long *cycles = process.runs.cycles.data();
+        long long start = cycles[programCounter];
+        int next = lower_bound(cycles + programCounter + 1, cycles + instructionSize + 1,
+                               start + (CPUAllocated - burstCycles)) - cycles;
+        if (next > instructionSize)
+        {
+            next = instructionSize;
+        }
+        else if (cycles[next] - start >= COMPUTE_RUN_BARRIER)
+        {
+            next--; // instruction next - 1 is not part of the run
+        }
+        if (eventLevels[EVENT_COMPUTE] <= activeLog->level)
+        {
+            for (int i = programCounter; i < next; i++)
+            {
+                logEvent(EVENT_COMPUTE, globalClock + (cycles[i] - start), processID);
+            }
+        }
+        int elapsed = cycles[next] - start;
+        cpuCyclesUsed += elapsed;
+        globalClock += elapsed;
+        burstCycles += elapsed;
+        programCounter = next;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_PRINT, printOp)
+    { // Print: 2 cycles
+        int ioCycles = op->value;
+        logEvent(EVENT_IO_INTERRUPT, globalClock, processID);
+        mainMemory[startAddress + 1] = 4;
+        mainMemory[startAddress + 2] = programCounter + 1; // point to next
+
+        cpuCyclesUsed += ioCycles;
+        mainMemory[startAddress + 6] = cpuCyclesUsed;
+        mainMemory[startAddress + 7] = registerValue;
+        cpuCyclesUsed += ioCycles;
+        // burstCycles += ioCycles;
+        ioWaitQueue.push(startAddress, globalClock, ioCycles);
+        return;
+    }
+    MICRO_OP(MICRO_STORE, storeOp)
+    { // Store: 3 value address
+        registerValue = op->value;
+        mainMemory[op->address] = registerValue;
+        if (op->address < dataBase + process.dataOffsets[instructionSize])
+        { // The Store hit this program's code or operands
+            operandShift += storeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                           maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                           op->address, programCounter);
+        }
+        logEvent(EVENT_STORED, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_STORE_TRANSLATED, storeTranslatedOp)
+    { // Store: 3 value address, address is logical
+        registerValue = op->value;
+        mainMemory[translateAddress(*translation, op->address)] = registerValue;
+        if (op->address < dataBase + process.dataOffsets[instructionSize])
+        {
+            operandShift += storeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                           maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                           op->address, programCounter);
+        }
+        logEvent(EVENT_STORED, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_STORE_PAGED, storePagedOp)
+    { // Store: 3 value address, address is logical
+        registerValue = op->value;
+        int physical = pageAddress(*paging, memoryList, mainMemory, processes, slot, op->address, true, globalClock);
+        if (physical != -1)
+        {
+            mainMemory[physical] = registerValue;
+        }
+        if (op->address < dataBase + process.dataOffsets[instructionSize])
+        {
+            operandShift += storeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                           maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                           op->address, programCounter);
+        }
+        logEvent(EVENT_STORED, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_STORE_SHARED, storeSharedOp)
+    { // Store: 3 value address, address is logical
+        registerValue = op->value;
+        int physical = writableAddress(*memoryList.sharing, memoryList, mainMemory, process, op->address, globalClock);
+        if (physical == -1)
+        { // no memory for a private copy of the page, the Store is lost
+            logEvent(EVENT_STORE_ERROR, globalClock, processID);
+        }
+        else
+        {
+            mainMemory[physical] = registerValue;
+            if (op->address < dataBase + process.dataOffsets[instructionSize])
+            {
+                operandShift += storeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                               maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                               op->address, programCounter);
+            }
+            logEvent(EVENT_STORED, globalClock, processID);
+        }
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_STORE_ERROR, storeErrorOp)
+    {
+        registerValue = op->value;
+        logEvent(EVENT_STORE_ERROR, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_LOAD, loadOp)
+    { // Load: 4 address
+        registerValue = mainMemory[op->address];
+        logEvent(EVENT_LOADED, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_LOAD_TRANSLATED, loadTranslatedOp)
+    { // Load: 4 address, address is logical
+        registerValue = mainMemory[translateAddress(*translation, op->address)];
+        logEvent(EVENT_LOADED, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_LOAD_PAGED, loadPagedOp)
+    { // Load: 4 address, address is logical
+        int physical = pageAddress(*paging, memoryList, mainMemory, processes, slot, op->address, false, globalClock);
+        registerValue = physical == -1 ? -1 : (int)mainMemory[physical];
+        logEvent(EVENT_LOADED, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_LOAD_SHARED, loadSharedOp)
+    { // Load: 4 address, address is logical
+        registerValue = sharedWord(mainMemory, *translation, op->address);
+        logEvent(EVENT_LOADED, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_LOAD_ERROR, loadErrorOp)
+    { // Load outside the process, it still reads the word it addresses unless no such word
+      // exists: past the end of main memory, or at a logical address of a translated process,
+      // the register keeps its value
+        if (translation == NULL && op->address >= 0 && op->address < maxMemory)
+        {
+            registerValue = mainMemory[op->address];
+        }
+        logEvent(EVENT_LOAD_ERROR, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_FORK, forkOp)
+    { // Fork: 5 child PID, a system call, the parent gives up the CPU and is ready again ahead of its child
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        mainMemory[startAddress + 1] = 1;
+        mainMemory[startAddress + 2] = programCounter + 1;
+        mainMemory[startAddress + 6] = cpuCyclesUsed;
+        readyQueue.push(startAddress, globalClock);
+        forkProcess(op->value, slot, mainMemory, memoryList, processes, readyQueue, globalClock);
+        return;
+    }
+    MICRO_OP(MICRO_FILL, fillOp)
+    { // Fill: 6 value address count, the range was bounds checked as a whole when decoded
+        int address = op->address;
+        int count = op->count;
+        registerValue = op->value;
+        fillWords(mainMemory, address, count, registerValue);
+        operandShift += storeRangeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                            maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                            address, count, programCounter);
+        logEvent(EVENT_FILLED, globalClock, processID);
+        int cycles = bulk.charge(count);
+        cpuCyclesUsed += cycles;
+        globalClock += cycles;
+        burstCycles += cycles;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_COPY, copyOp)
+    { // Copy: 7 source destination count
+        int address = op->address;
+        int count = op->count;
+        copyWords(mainMemory, op->value, address, count);
+        operandShift += storeRangeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                            maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                            address, count, programCounter);
+        logEvent(EVENT_COPIED, globalClock, processID);
+        int cycles = bulk.charge(count);
+        cpuCyclesUsed += cycles;
+        globalClock += cycles;
+        burstCycles += cycles;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_SUM, sumOp)
+    { // Sum: 8 address count
+        registerValue = sumWords(mainMemory, op->address, op->count);
+        logEvent(EVENT_SUMMED, globalClock, processID);
+        int cycles = bulk.charge(op->count);
+        cpuCyclesUsed += cycles;
+        globalClock += cycles;
+        burstCycles += cycles;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_FILL_TRANSLATED, fillTranslatedOp)
+    { // Fill: 6 value address count, addresses are logical and translated word by word
+        int address = op->address;
+        int count = op->count;
+        bool lost = false; // a word no memory backs, as with a Store
+        registerValue = op->value;
+        for (int i = 0; i < count; i++)
+        {
+            int physical = translatedWord(mainMemory, memoryList, processes, slot, address + i, true, globalClock);
+            if (physical == -1)
+            {
+                lost = true;
+                continue;
+            }
+            mainMemory[physical] = registerValue;
+        }
+        operandShift += storeRangeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                            maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                            address, count, programCounter);
+        logEvent(lost ? EVENT_BULK_ERROR : EVENT_FILLED, globalClock, processID);
+        int cycles = bulk.charge(count);
+        cpuCyclesUsed += cycles;
+        globalClock += cycles;
+        burstCycles += cycles;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_COPY_TRANSLATED, copyTranslatedOp)
+    { // Copy: 7 source destination count, addresses are logical
+        int source = op->value;
+        int address = op->address;
+        int count = op->count;
+        bool lost = false;
+        // Copied back to front when the destination starts inside the source, like memmove
+        bool backwards = address > source;
+        for (int i = 0; i < count; i++)
+        {
+            int offset = backwards ? count - 1 - i : i;
+            int from = translatedWord(mainMemory, memoryList, processes, slot, source + offset, false, globalClock);
+            int value = from == -1 ? -1 : (int)mainMemory[from];
+            int to = translatedWord(mainMemory, memoryList, processes, slot, address + offset, true, globalClock);
+            if (from == -1 || to == -1)
+            {
+                lost = true;
+            }
+            if (to != -1)
+            {
+                mainMemory[to] = value;
+            }
+        }
+        operandShift += storeRangeToProgram(mainMemory, translation, instructionBase, instructionSize,
+                                            maxMemoryNeeded, process.dataOffsets, process.program, process.runs,
+                                            address, count, programCounter);
+        logEvent(lost ? EVENT_BULK_ERROR : EVENT_COPIED, globalClock, processID);
+        int cycles = bulk.charge(count);
+        cpuCyclesUsed += cycles;
+        globalClock += cycles;
+        burstCycles += cycles;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_SUM_TRANSLATED, sumTranslatedOp)
+    { // Sum: 8 address count, addresses are logical, a word no memory backs reads as -1
+        unsigned total = 0;
+        for (int i = 0; i < op->count; i++)
+        {
+            int physical = translatedWord(mainMemory, memoryList, processes, slot, op->address + i, false, globalClock);
+            total += physical == -1 ? -1 : (int)mainMemory[physical];
+        }
+        registerValue = (int)total;
+        logEvent(EVENT_SUMMED, globalClock, processID);
+        int cycles = bulk.charge(op->count);
+        cpuCyclesUsed += cycles;
+        globalClock += cycles;
+        burstCycles += cycles;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_BULK_ERROR, bulkErrorOp)
+    { // Fill, Copy or Sum of a range that does not lie within the process
+        logEvent(EVENT_BULK_ERROR, globalClock, processID);
+        cpuCyclesUsed += 1;
+        globalClock += 1;
+        burstCycles += 1;
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+    MICRO_OP(MICRO_INVALID, invalidOp)
+    {
+        logEvent(EVENT_INVALID_OPCODE, globalClock, processID, {op->value});
+        programCounter += 1;
+        END_OF_INSTRUCTION();
+    }
+#if !THREADED_DISPATCH
+    }
+#endif
+#undef END_OF_INSTRUCTION
+#undef MICRO_OP
+#undef DISPATCH_NEXT
+
+fetch:
+    // A paged process references the page of each instruction it fetches
+    if (paging != NULL)
+    {
+        pageAddress(*paging, memoryList, mainMemory, processes, slot, instructionBase + programCounter, false,
+                    globalClock);
+    }
+    // The old interpreter moved its operand offset forward as it stepped through
+    // a time slice and only summed the opcodes again when the process was next
+    // dispatched, so the shift lasts until this slice ends and the rebuilt table
+    // is used from the next dispatch on
+    if (operandShift != 0)
+    {
+        shiftedOp = decodeInstruction(mainMemory, translation, instructionBase, dataBase, maxMemoryNeeded,
+                                      programCounter, process.dataOffsets[programCounter] - operandShift);
+        op = &shiftedOp;
+    }
+#if THREADED_DISPATCH
+    goto *dispatchTable[op->kind];
+#else
+    goto execute;
+#endif
+
+timeOut:
+    mainMemory[startAddress + 1] = 1;
+    mainMemory[startAddress + 2] = programCounter;
+    mainMemory[startAddress + 6] = cpuCyclesUsed;
+    mainMemory[startAddress + 7] = registerValue; // Save updated registerValue
+    readyQueue.preempted(startAddress);
+    readyQueue.push(startAddress, globalClock);
+    logEvent(EVENT_TIMEOUT, globalClock, processID);
+    return;
+
+burstEnd:
+    if (programCounter >= dataBase - instructionBase)
+    {
+        programCounter = instructionBase - 1;
+        mainMemory[startAddress + 1] = 3;
+        mainMemory[startAddress + 2] = programCounter;
+        mainMemory[startAddress + 6] = cpuCyclesUsed;
+        mainMemory[startAddress + 7] = registerValue; // Save updated registerValue
+        int startTime = process.startTime;
+        int endTime = globalClock;
+        process.endTime = endTime;
+        readyQueue.finished(process);
+        totalCpuTime += cpuCyclesUsed;
+        logEvent(EVENT_TERMINATED, globalClock, processID,
+                 {programCounter, instructionBase, dataBase, memoryLimit, cpuCyclesUsed, registerValue,
+                  maxMemoryNeeded, mainMemoryBase, startTime, endTime});
+        freeBlock(processID, processes, memoryList, mainMemory, globalClock);
+        loadJobsToMemory(newJobQueue, readyQueue, mainMemory, maxMemory, memoryList, processes, globalClock);
+        //printList(memoryList); // Debug output
+        //printNewJobQueue(newJobQueue); // Debug output
+    }
+    else
+    {
+        mainMemory[startAddress + 1] = 1;
+        mainMemory[startAddress + 2] = programCounter;
+        mainMemory[startAddress + 6] = cpuCyclesUsed;
+        mainMemory[startAddress + 7] = registerValue; // Save updated registerValue
+        readyQueue.preempted(startAddress);
+        readyQueue.push(startAddress, globalClock);
+        logEvent(EVENT_READY, globalClock, processID);
+    }
+}
+
+// Simulated CPU core with its own ready queue and clock
+// The core whose clock is furthest behind always runs next, so shared state
+// (memory, the IO queue and the new job queue) sees events in time order
+struct cpuCore
+{
+    scheduler readyQueue;
+    int clock = 0;
+    long long busyCycles = 0; // cycles spent running processes, context switches excluded
+    long long dispatches = 0;
+    long long steals = 0;     // processes taken from other cores' ready queues
+    long long migrations = 0; // dispatches of a process that last ran on another core
+};
+
+// Function to move a ready process from another core to an idle one
+// Victims are scanned from a seeded pseudo-random core so runs are reproducible;
+// a process that became ready after the thief's clock makes the thief wait for it
+// Returns false if every other ready queue is empty
+bool stealWork(vector<cpuCore> &cores, int thief, unsigned long long &stealState)
+{
+    int coreCount = cores.size();
+    stealState += 0x9e3779b97f4a7c15ULL;
+    int start = hashKey(stealState) % coreCount;
+    for (int i = 0; i < coreCount; i++)
+    {
+        int victim = (start + i) % coreCount;
+        if (victim == thief || cores[victim].readyQueue.empty())
+        {
+            continue;
+        }
+        readyEntry entry = cores[victim].readyQueue.steal();
+        cpuCore &core = cores[thief];
+        core.clock = max(core.clock, entry.readyTime);
+        core.readyQueue.push(entry.startAddress, entry.readyTime);
+        core.steals++;
+        return true;
+    }
+    return false;
+}
+
+// Owner of the free block a relocation is moving a process down over
+// It is out of the free lists until the move ends, so nothing is allocated
+// over words that are still being copied
+const long long COMPACTION_HOLE = LLONG_MIN;
+
+// Incremental compaction: resident blocks slide down over the free block in
+// front of them, a bounded number of words per scheduling tick
+struct compactionState
+{
+    int wordsPerTick = 0; // 0 disables compaction
+    int block = -1;       // block being moved, -1 between moves
+    int hole = -1;        // reserved free block the block is moving over
+    int from = 0;         // address the block is moving from
+    int copied = 0;       // words already at the new address
+    long long relocations = 0;
+    long long wordsMoved = 0;
+};
+
+// Function to start moving the lowest resident block that has free space below it
+// The block and the free block swap places in the block list right away. The
+// PCB (and segment table) is copied first so the process table, the PCB base
+// fields and the queued addresses can all refer to the new address from the
+// start; the rest of the process is only read when it runs, and dispatching
+// it finishes the move first
+// Pages of forked processes stay where they are, a free block in front of one is skipped
+// Returns the number of words copied or -1 if memory is already compact
+int beginRelocation(compactionState &compaction, memoryAllocator &memoryList, memoryWord *mainMemory,
+                    processTable &processes, vector<cpuCore> &cores, ioTimerQueue &ioWaitQueue, int clock)
+{
+    int hole = memoryList.firstBlock;
+    while (hole != -1 && (memoryList.blocks[hole].processID != -1 || memoryList.blocks[hole].nextBlock == -1 ||
+                          memoryList.blocks[memoryList.blocks[hole].nextBlock].sharers > 0))
+    {
+        hole = memoryList.blocks[hole].nextBlock;
+    }
+    if (hole == -1)
+    {
+        return -1;
+    }
+    int index = memoryList.blocks[hole].nextBlock; // free blocks are coalesced first, so this one is in use
+    memoryBlock &free = memoryList.blocks[hole];
+    memoryBlock &block = memoryList.blocks[index];
+    int from = block.startingAddress;
+    int to = free.startingAddress;
+    int delta = to - from;
+
+    removeFreeBlock(memoryList, hole);
+    free.processID = COMPACTION_HOLE;
+    int before = free.prevBlock;
+    int after = block.nextBlock;
+    block.prevBlock = before;
+    block.nextBlock = hole;
+    free.prevBlock = index;
+    free.nextBlock = after;
+    if (before != -1)
+    {
+        memoryList.blocks[before].nextBlock = index;
+    }
+    else
+    {
+        memoryList.firstBlock = index;
+    }
+    if (after != -1)
+    {
+        memoryList.blocks[after].prevBlock = hole;
+    }
+    block.startingAddress = to;
+    free.startingAddress = to + block.size;
+
+    int slot = findProcess(processes, block.processID);
+    processEntry &process = processes.entries[slot];
+    int segment = 0;
+    while (process.blocks[segment] != index)
+    {
+        segment++;
+    }
+    int header = segment > 0 ? 0 : process.segmentTable == -1 ? PCB_SIZE : SEGMENTED_HEADER_SIZE;
+    memmove(mainMemory + to, mainMemory + from, header * sizeof(memoryWord));
+    if (segment == 0)
+    {
+        hashIndexErase(processes.byBaseAddress, from);
+        hashIndexInsert(processes.byBaseAddress, to, slot);
+        process.mainMemoryBase = to;
+        mainMemory[to + 9] = to;
+        if (process.segmentTable == -1)
+        { // contiguous processes hold physical addresses
+            mainMemory[to + 3] += delta;
+            mainMemory[to + 4] += delta;
+            for (microOp &op : process.program)
+            {
+                if ((op.kind >= MICRO_STORE && op.kind <= MICRO_LOAD_ERROR) || op.kind == MICRO_FILL ||
+                    op.kind == MICRO_SUM)
+                {
+                    op.address += delta;
+                }
+                else if (op.kind == MICRO_COPY)
+                {
+                    op.value += delta;
+                    op.address += delta;
+                }
+            }
+        }
+        else
+        {
+            process.segmentTable = to + PCB_SIZE;
+        }
+        for (cpuCore &core : cores)
+        {
+            core.readyQueue.relocate(from, to);
+        }
+        ioWaitQueue.relocate(from, to);
+    }
+    if (process.segmentTable != -1)
+    {
+        mainMemory[process.segmentTable + 1 + segment * 2] = to;
+        process.translation.segmentStarts[segment] = to;
+        invalidateTranslation(process.translation);
+    }
+
+    compaction.block = index;
+    compaction.hole = hole;
+    compaction.from = from;
+    compaction.copied = header;
+    compaction.relocations++;
+    logEvent(EVENT_PROCESS_RELOCATED, clock, process.processID, {segment, from, to, block.size});
+    return header;
+}
+
+// Function to copy up to budget more words of the block being moved
+// Copying upwards through a block that moves down never overwrites a word
+// that is still to be copied. The last copy frees the vacated words and
+// returns the reserved block to the free lists
+// Returns the number of words copied
+int continueRelocation(compactionState &compaction, memoryAllocator &memoryList, memoryWord *mainMemory, int budget)
+{
+    const memoryBlock &block = memoryList.blocks[compaction.block];
+    int count = min(budget, block.size - compaction.copied);
+    memmove(mainMemory + block.startingAddress + compaction.copied, mainMemory + compaction.from + compaction.copied,
+            count * sizeof(memoryWord));
+    compaction.copied += count;
+    if (compaction.copied < block.size)
+    {
+        return count;
+    }
+
+    releaseWords(mainMemory, block.startingAddress + block.size, compaction.from - block.startingAddress);
+    releaseBlock(memoryList, compaction.hole);
+    compaction.block = -1;
+    compaction.hole = -1;
+    return count;
+}
+
+// Function to run compaction for one scheduling tick
+// Blocks are moved until wordsPerTick words have been copied or a free block
+// of the required size exists; a move that is cut off continues next tick.
+// Free blocks are coalesced before each move
+// Returns the number of words copied, the caller charges one cycle per word
+int compactMemory(compactionState &compaction, int requiredSize, memoryAllocator &memoryList, memoryWord *mainMemory,
+                  processTable &processes, vector<cpuCore> &cores, ioTimerQueue &ioWaitQueue, int clock)
+{
+    int moved = 0;
+    while (moved < compaction.wordsPerTick)
+    {
+        if (compaction.block != -1)
+        {
+            moved += continueRelocation(compaction, memoryList, mainMemory, compaction.wordsPerTick - moved);
+            continue;
+        }
+        coalesceFreeBlocks(memoryList);
+        if (hasSufficientMemoryBlock(memoryList, requiredSize))
+        {
+            break;
+        }
+        int copied = beginRelocation(compaction, memoryList, mainMemory, processes, cores, ioWaitQueue, clock);
+        if (copied == -1)
+        {
+            break;
+        }
+        moved += copied;
+    }
+    compaction.wordsMoved += moved;
+    return moved;
+}
+
+// Memory dump formats
+enum memoryDumpFormat
+{
+    DUMP_WORDS, // one "address : value" line per word
+    DUMP_RUNS,  // one line per run of equal words, under the block holding them
+    DUMP_BINARY // regions and runs appended to a dump file
+};
+
+// Binary dump file layout: the magic string, then one record per dump made of
+// clock, memory size and region count (int64), the regions (first address,
+// last address and segment as int32, owner PID as int64), the run count
+// (int64) and the runs (first address, last address and value as int32)
+const char DUMP_MAGIC[8] = {'O', 'S', 'S', 'I', 'M', 'D', 'M', '1'};
+
+// Allocator block in a memory dump, owner is -1 for a free block
+struct memoryRegion
+{
+    int first;
+    int last;
+    int segment; // segment (or page) number within the owning process, -1 if no process owns it
+    long long owner;
+};
+
+// Run of equal words in a memory dump
+struct memoryRun
+{
+    int first;
+    int last;
+    int value;
+};
+
+// Function to describe main memory block by block, collapsing runs of equal words
+// Runs never cross a block boundary, so each belongs to exactly one region
+void describeMemory(const memoryWord *mainMemory, const memoryAllocator &memoryList, const processTable &processes,
+                    vector<memoryRegion> &regions, vector<memoryRun> &runs)
+{
+    for (int index = memoryList.firstBlock; index != -1; index = memoryList.blocks[index].nextBlock)
+    {
+        const memoryBlock &block = memoryList.blocks[index];
+        int segment = -1;
+        int slot = block.processID == -1 || block.processID == COMPACTION_HOLE ? -1
+                                                                             : findProcess(processes, block.processID);
+        if (slot != -1)
+        {
+            const processEntry &process = processes.entries[slot];
+            const vector<pageEntry> &pages = process.translation.pages;
+            if (pages.empty())
+            {
+                for (segment = 0; segment < process.blockCount && process.blocks[segment] != index; segment++)
+                {
+                }
+            }
+            else
+            { // a frame of a paged process is numbered by the page it holds
+                for (segment = 0; segment < (int)pages.size() && pages[segment].block != index; segment++)
+                {
+                }
+            }
+        }
+        int end = block.startingAddress + block.size;
+        regions.push_back({block.startingAddress, end - 1, segment, block.processID});
+        if (block.processID == -1)
+        {
+            runs.push_back({block.startingAddress, end - 1, -1}); // free words are always -1
+            continue;
+        }
+        for (int i = block.startingAddress; i < end;)
+        {
+            int j = i + 1;
+            while (j < end && mainMemory[j] == mainMemory[i])
+            {
+                j++;
+            }
+            runs.push_back({i, j - 1, mainMemory[i]});
+            i = j;
+        }
+    }
+}
+
+// Function to log a described memory dump as text
+void logMemoryDump(int clock, long long memorySize, const vector<memoryRegion> &regions,
+                   const vector<memoryRun> &runs)
+{
+    logEvent(EVENT_MEMORY_DUMP, clock, -1, {memorySize});
+    size_t run = 0;
+    for (const memoryRegion &region : regions)
+    {
+        logEvent(EVENT_MEMORY_REGION, clock, region.owner, {region.first, region.last, region.segment});
+        for (; run < runs.size() && runs[run].first <= region.last; run++)
+        {
+            logEvent(EVENT_MEMORY_RUN, clock, -1, {runs[run].first, runs[run].last, runs[run].value});
+        }
+    }
+}
+
+// Function to append a described memory dump to a binary dump file
+// Returns false if the file cannot be written
+bool writeMemoryDump(FILE *out, int clock, long long memorySize, const vector<memoryRegion> &regions,
+                     const vector<memoryRun> &runs)
+{
+    string record;
+    long long header[3] = {clock, memorySize, (long long)regions.size()};
+    appendBinary(record, header, sizeof(header));
+    for (const memoryRegion &region : regions)
+    {
+        int bounds[3] = {region.first, region.last, region.segment};
+        appendBinary(record, bounds, sizeof(bounds));
+        appendBinary(record, &region.owner, sizeof(region.owner));
+    }
+    long long runCount = runs.size();
+    appendBinary(record, &runCount, sizeof(runCount));
+    for (const memoryRun &run : runs)
+    {
+        int fields[3] = {run.first, run.last, run.value};
+        appendBinary(record, fields, sizeof(fields));
+    }
+    return fwrite(record.data(), 1, record.size(), out) == record.size();
+}
+
+// Function to render a binary memory dump file as text on stdout
+// Returns false if the file cannot be read or is not a memory dump
+bool decodeDump(const string &path)
+{
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in == NULL)
+    {
+        cerr << "Error: cannot open dump file " << path << "." << endl;
+        return false;
+    }
+    char magic[sizeof(DUMP_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, DUMP_MAGIC, sizeof(magic)) != 0)
+    {
+        cerr << "Error: " << path << " is not a memory dump." << endl;
+        fclose(in);
+        return false;
+    }
+    eventLog log;
+    log.level = LOG_SUMMARY;
+    activeLog = &log;
+    bool valid = true;
+    long long header[3];
+    vector<memoryRegion> regions;
+    vector<memoryRun> runs;
+    while (valid && fread(header, sizeof(header), 1, in) == 1)
+    {
+        regions.clear();
+        runs.clear();
+        long long runCount = -1;
+        for (long long i = 0; valid && i < header[2]; i++)
+        {
+            int bounds[3];
+            long long owner;
+            valid = fread(bounds, sizeof(bounds), 1, in) == 1 && fread(&owner, sizeof(owner), 1, in) == 1;
+            regions.push_back({bounds[0], bounds[1], bounds[2], owner});
+        }
+        valid = valid && fread(&runCount, sizeof(runCount), 1, in) == 1;
+        for (long long i = 0; valid && i < runCount; i++)
+        {
+            int fields[3];
+            valid = fread(fields, sizeof(fields), 1, in) == 1;
+            runs.push_back({fields[0], fields[1], fields[2]});
+        }
+        if (!valid)
+        {
+            cerr << "Error: truncated dump in " << path << "." << endl;
+            break;
+        }
+        logMemoryDump(header[0], header[1], regions, runs);
+        if (log.buffer.size() >= LOG_FLUSH_SIZE)
+        {
+            flushLog();
+        }
+    }
+    flushLog();
+    activeLog = NULL;
+    fclose(in);
+    return valid;
+}
+
+// Synthetic workload parameters for --generate and --bench
+// Ranges are inclusive, the opcode mix gives relative weights of
+// Compute, Print, Store, Load, Fill, Copy and Sum
+struct workloadSpec
+{
+    unsigned long long seed = 1;
+    int jobs = 1000;
+    int maxMemory = 4096;
+    int quantum = 8;
+    int switchTime = 1;
+    int instructions[2] = {1, 16};
+    int slack[2] = {0, 8}; // data words beyond the operands, the only words a job writes to
+    int cycles[2] = {1, 10}; // Compute cycles
+    int io[2] = {1, 20};     // Print IO cycles
+    int bulk[2] = {1, 16};   // words a Fill, Copy or Sum covers, at most the words it may touch
+    int mix[7] = {4, 1, 2, 2, 0, 0, 0};
+};
+
+// Seeded splitmix64 sequence, the same seed always gives the same workload
+struct workloadRandom
+{
+    unsigned long long state;
+
+    unsigned long long next()
+    {
+        state += 0x9e3779b97f4a7c15ULL;
+        return hashKey(state);
+    }
+    int range(const int bounds[2])
+    {
+        return bounds[0] + (int)(next() % (unsigned long long)(bounds[1] - bounds[0] + 1));
+    }
+};
+
+// Function to parse a workload spec such as "jobs=5000,instructions=4-64,mix=4:0:1:1"
+// Keys: seed, jobs, memory, quantum, switch, instructions, slack, cycles, io, bulk, mix
+// The mix has four weights, or seven with the bulk memory instructions
+bool parseWorkloadSpec(const string &text, workloadSpec &spec)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t comma = text.find(',', start);
+        string item = text.substr(start, comma == string::npos ? string::npos : comma - start);
+        start = comma == string::npos ? text.size() : comma + 1;
+        size_t equals = item.find('=');
+        if (equals == string::npos)
+        {
+            return false;
+        }
+        string key = item.substr(0, equals);
+        const char *value = item.c_str() + equals + 1;
+        int *range = key == "instructions" ? spec.instructions : key == "slack" ? spec.slack
+                     : key == "cycles" ? spec.cycles : key == "io" ? spec.io : key == "bulk" ? spec.bulk : NULL;
+        if (range != NULL)
+        {
+            if (sscanf(value, "%d-%d", &range[0], &range[1]) != 2 || range[0] < 0 || range[1] < range[0])
+            {
+                return false;
+            }
+        }
+        else if (key == "mix")
+        {
+            int *mix = spec.mix;
+            int weights = sscanf(value, "%d:%d:%d:%d:%d:%d:%d", &mix[0], &mix[1], &mix[2], &mix[3], &mix[4],
+                                 &mix[5], &mix[6]);
+            if (weights != 4 && weights != 7)
+            {
+                return false;
+            }
+            int total = 0;
+            for (int i = 0; i < 7; i++)
+            {
+                mix[i] = i < weights ? mix[i] : 0;
+                if (mix[i] < 0)
+                {
+                    return false;
+                }
+                total += mix[i];
+            }
+            if (total == 0)
+            {
+                return false;
+            }
+        }
+        else if (key == "seed")
+        {
+            spec.seed = strtoull(value, NULL, 10);
+        }
+        else if (key == "jobs" || key == "memory" || key == "quantum" || key == "switch")
+        {
+            int number = atoi(value);
+            int &field = key == "jobs" ? spec.jobs : key == "memory" ? spec.maxMemory
+                         : key == "quantum" ? spec.quantum : spec.switchTime;
+            field = number;
+            if (number < 0 || (number == 0 && key != "switch"))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return spec.instructions[0] > 0;
+}
+
+// Function to generate the jobs of a workload
+// Store addresses and Fill and Copy destinations always land in the slack
+// words past the operands, so generated programs never overwrite their own
+// opcodes or operands; a job that writes gets at least one such word
+void generateJobs(const workloadSpec &spec, vector<PCB> &jobs)
+{
+    workloadRandom random = {spec.seed};
+    int mixTotal = 0;
+    for (int weight : spec.mix)
+    {
+        mixTotal += weight;
+    }
+    jobs.resize(spec.jobs);
+    for (int i = 0; i < spec.jobs; i++)
+    {
+        PCB &job = jobs[i];
+        job.processID = i + 1;
+        job.instructionSize = random.range(spec.instructions);
+        job.logicalMemory.clear();
+        int operandWords = 0;
+        bool writes = false;
+        vector<int> opcodes(job.instructionSize);
+        for (int &opcode : opcodes)
+        {
+            const int mixOpcodes[7] = {1, 2, 3, 4, 6, 7, 8}; // Fork is never generated
+            int pick = random.next() % mixTotal;
+            int weight = 0;
+            while (pick >= spec.mix[weight])
+            {
+                pick -= spec.mix[weight];
+                weight++;
+            }
+            opcode = mixOpcodes[weight];
+            operandWords += operandCount(opcode);
+            writes = writes || opcode == 3 || opcode == 6 || opcode == 7;
+        }
+        int dataStart = job.instructionSize + operandWords;
+        job.maxMemoryNeeded = dataStart + max(random.range(spec.slack), writes ? 1 : 0);
+        for (int opcode : opcodes)
+        {
+            job.logicalMemory.push_back(opcode);
+            const int values[2] = {1, 99};
+            const int dataWords[2] = {dataStart, job.maxMemoryNeeded - 1};
+            const int anyWord[2] = {0, job.maxMemoryNeeded - 1};
+            switch (opcode)
+            {
+            case 1:
+                job.logicalMemory.push_back(1);
+                job.logicalMemory.push_back(random.range(spec.cycles));
+                break;
+            case 2:
+                job.logicalMemory.push_back(random.range(spec.io));
+                break;
+            case 3:
+                job.logicalMemory.push_back(random.range(values));
+                job.logicalMemory.push_back(random.range(dataWords));
+                break;
+            case 4:
+                job.logicalMemory.push_back(random.range(anyWord));
+                break;
+            case 6:
+            case 7:
+            case 8:
+            {
+                // a Sum only reads, so it may cover the operands as well
+                int room = job.maxMemoryNeeded - (opcode == 8 ? job.instructionSize : dataStart);
+                int count = min(random.range(spec.bulk), room);
+                const int dataRange[2] = {dataStart, job.maxMemoryNeeded - count};
+                const int anyRange[2] = {0, job.maxMemoryNeeded - count};
+                if (opcode == 6)
+                {
+                    job.logicalMemory.push_back(random.range(values));
+                    job.logicalMemory.push_back(random.range(dataRange));
+                }
+                else if (opcode == 7)
+                {
+                    job.logicalMemory.push_back(random.range(anyRange));
+                    job.logicalMemory.push_back(random.range(dataRange));
+                }
+                else
+                {
+                    job.logicalMemory.push_back(random.range(anyRange));
+                }
+                job.logicalMemory.push_back(count);
+                break;
+            }
+            }
+        }
+        job.state = 1;
+        job.programCounter = 0;
+        job.cpuCyclesUsed = 0;
+        job.registerValue = 0;
+        job.startTime = -1;
+        job.endTime = -1;
+        job.memoryLimit = job.maxMemoryNeeded;
+    }
+}
+
+// Function to write a workload in the job file format
+void writeJobs(const workloadSpec &spec, const vector<PCB> &jobs, FILE *out)
+{
+    string text;
+    appendNumber(text, spec.maxMemory);
+    text += ' '; appendNumber(text, spec.quantum);
+    text += ' '; appendNumber(text, spec.switchTime);
+    text += '\n'; appendNumber(text, jobs.size());
+    text += '\n';
+    for (const PCB &job : jobs)
+    {
+        appendNumber(text, job.processID);
+        text += ' '; appendNumber(text, job.maxMemoryNeeded);
+        text += ' '; appendNumber(text, job.instructionSize);
+        for (int word : job.logicalMemory)
+        {
+            text += ' '; appendNumber(text, word);
+        }
+        text += '\n';
+        if (text.size() >= LOG_FLUSH_SIZE)
+        {
+            fwrite(text.data(), 1, text.size(), out);
+            text.clear();
+        }
+    }
+    fwrite(text.data(), 1, text.size(), out);
+    fflush(out);
+}
+
+// Command line options
+struct simulatorOptions
+{
+    int logLevel = LOG_INSTRUCTIONS;
+    bool binaryLog = false;
+    string logFile;    // event log destination, stdout if empty
+    bool logThread = false; // render and write the event log on a second thread
+    string decodeFile; // binary log to render as text instead of simulating
+    string decodeDumpFile; // binary memory dump to render as text instead of simulating
+    string inputFile;  // job file, stdin if empty
+    bool preloadJobs = false;
+    bool segmented = false; // split jobs across free blocks when no single block fits
+    int policy = SCHEDULE_ROUND_ROBIN;
+    bool reportSchedule = false; // print the scheduler report, set once a policy is chosen
+    string prioritiesFile;
+    int cores = 1;
+    unsigned long long stealSeed = 1;
+    bool sweep = false; // run a grid of configurations instead of one simulation
+    vector<int> sweepMemory;
+    vector<int> sweepQuantum;
+    vector<int> sweepSwitch;
+    int threads = 0; // sweep threads, 0 for one per hardware thread
+    bool generate = false; // write a synthetic job file to stdout instead of simulating
+    bool bench = false;    // run the benchmarks instead of simulating
+    workloadSpec workload;
+    string checkpointFile;   // write checkpoints here
+    int checkpointEvery = 0; // clock cycles between checkpoints, 0 for SIGUSR1 only
+    string restoreFile;      // resume from this checkpoint
+    int quantumOverride = -1; // replace the CPU time slice of the job file or checkpoint
+    int switchOverride = -1;  // replace the context switch time
+    int compactWords = 0;     // words compaction may move per scheduling tick, 0 for no compaction
+    int backfillWindow = 0;   // waiting jobs that may be loaded past a blocked head, 0 for none
+    int backfillWait = 1000;  // cycles a blocked head waits before memory is reserved for it
+    bool paged = false;       // demand paged virtual memory backed by a swap file
+    int pageSize = 16;
+    int replacement = REPLACE_CLOCK;
+    int workingSetWindow = 1000; // cycles, for the working set replacement policy
+    int pageFaultTime = 20;      // cycles a page fault stalls the faulting core
+    int bulkWords = 8;           // words a Fill, Copy or Sum covers per cycle
+    string swapFile;             // swap file path, an unnamed temporary file if empty
+    string metricsFile;       // metrics export destination, none if empty
+    bool metricsJson = true;  // JSON file, or a set of CSV files named after metricsFile
+    int metricsInterval = 100; // clock cycles between samples of the queues and memory
+    int dumpFormat = DUMP_WORDS;
+    bool dumpAtStart = true;   // dump memory once the first jobs are loaded
+    vector<int> dumpTimes;     // clock times to dump memory at, ascending
+    string dumpFile;           // destination of binary dumps
+};
+
+void printUsage(const char *program)
+{
+    cerr << "Usage: " << program << " [options] < jobs.txt\n"
+         << "  --input=PATH          read jobs from PATH instead of stdin\n"
+         << "  --preload-jobs        parse every job before simulating instead of streaming them\n"
+         << "  --segmented           load jobs that fit in no single free block as up to 6 segments\n"
+         << "  --scheduler=POLICY    rr (default), sjf, srtf, priority or mlfq\n"
+         << "  --priorities=PATH     \"PID priority\" pairs for the priority scheduler, lower runs first\n"
+         << "  --cores=N             simulate N CPU cores with work stealing (default 1)\n"
+         << "  --steal-seed=N        seed for choosing which core to steal from (default 1)\n"
+         << "  --sweep-memory=LIST   sweep main memory sizes, LIST is comma separated\n"
+         << "  --sweep-quantum=LIST  sweep CPU time slices\n"
+         << "  --sweep-switch=LIST   sweep context switch times\n"
+         << "  --threads=N           threads for a sweep (default one per hardware thread)\n"
+         << "  --compact=N           compact memory for jobs that fit in no free block,\n"
+         << "                        moving up to N words (1 cycle each) per scheduling tick\n"
+         << "  --backfill=N          when the next job does not fit, load the largest of the\n"
+         << "                        next N waiting jobs that does\n"
+         << "  --backfill-wait=N     stop backfilling past a job blocked for N cycles so memory\n"
+         << "                        frees up for it (default 1000, 0 never stops)\n"
+         << "  --paged               demand paged virtual memory: jobs only need a frame for\n"
+         << "                        their PCB page, other pages are swapped in when touched\n"
+         << "  --page-size=N         words per page and frame (default 16, at least 10), also the\n"
+         << "                        pages forked processes share copy-on-write\n"
+         << "  --replacement=POLICY  page replacement: clock (default), lru or ws (working set)\n"
+         << "  --working-set=N       working set window of the ws policy in cycles (default 1000)\n"
+         << "  --page-fault-time=N   cycles a page fault stalls its core (default 20)\n"
+         << "  --swap-file=PATH      back swapped pages with PATH (default an unnamed temporary file)\n"
+         << "  --bulk-words=N        words a Fill, Copy or Sum instruction covers per cycle, on top\n"
+         << "                        of one cycle to issue it (default 8)\n"
+         << "  --metrics=PATH        export per-process timings, percentiles and sampled queue\n"
+         << "                        depths, memory use and CPU utilization\n"
+         << "  --metrics-format=FMT  json (default, written to PATH) or csv (PATH-processes.csv,\n"
+         << "                        PATH-samples.csv and PATH-summary.csv)\n"
+         << "  --metrics-interval=N  clock cycles between metrics samples (default 100)\n"
+         << "  --dump=FORMAT         memory dump format: words (default, one line per word),\n"
+         << "                        runs (equal words collapsed, annotated by owner) or binary\n"
+         << "  --dump-at=LIST        dump memory at start and/or the listed clock times,\n"
+         << "                        none for no dumps (default start); SIGUSR2 dumps on demand\n"
+         << "  --dump-file=PATH      write binary dumps to PATH\n"
+         << "  --decode-dump=PATH    render a binary memory dump as text and exit\n"
+         << "  --quantum=N           override the CPU time slice of the job file\n"
+         << "  --switch-time=N       override the context switch time of the job file\n"
+         << "  --checkpoint=PATH     write a checkpoint to PATH on SIGUSR1 or periodically\n"
+         << "  --checkpoint-every=N  checkpoint every N clock cycles\n"
+         << "  --restore=PATH        resume from a checkpoint; the job input must be the same,\n"
+         << "                        scheduler, quantum and switch time options may change\n"
+         << "  --generate[=SPEC]     write a synthetic job file to stdout\n"
+         << "  --bench[=SPEC]        run the simulator benchmarks\n"
+         << "SPEC is a comma separated list of key=value pairs: seed, jobs, memory, quantum,\n"
+         << "switch, instructions=MIN-MAX, slack=MIN-MAX, cycles=MIN-MAX, io=MIN-MAX,\n"
+         << "bulk=MIN-MAX (words a Fill, Copy or Sum covers) and\n"
+         << "mix=COMPUTE:PRINT:STORE:LOAD[:FILL:COPY:SUM] weights\n"
+         << "  --log-level=LEVEL     off, summary, transitions or instructions (default)\n"
+         << "  --log-format=FORMAT   text (default) or binary event records\n"
+         << "  --log-file=PATH       write the event log to PATH instead of stdout\n"
+         << "  --log-thread          render and write the event log on a second thread\n"
+         << "  --decode-log=PATH     render a binary event log as text and exit\n";
+}
+
+// Function to parse a comma separated list of non-negative integers
+bool parseList(const string &text, vector<int> &values)
+{
+    values.clear();
+    const char *cursor = text.data();
+    const char *end = cursor + text.size();
+    while (cursor < end)
+    {
+        int value;
+        from_chars_result parsed = from_chars(cursor, end, value);
+        if (parsed.ec != errc() || value < 0 || (parsed.ptr < end && *parsed.ptr != ','))
+        {
+            return false;
+        }
+        values.push_back(value);
+        cursor = parsed.ptr + 1;
+    }
+    return !values.empty();
+}
+
+// Function to parse the command line into options
+// Returns false after reporting an unknown or malformed option
+bool parseOptions(int argc, char *argv[], simulatorOptions &options)
+{
+    const char *levelNames[] = {"off", "summary", "transitions", "instructions"};
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        size_t equals = arg.find('=');
+        string name = arg.substr(0, equals);
+        string value = equals == string::npos ? "" : arg.substr(equals + 1);
+        if (name == "--log-level")
+        {
+            options.logLevel = -1;
+            for (int level = LOG_OFF; level <= LOG_INSTRUCTIONS; level++)
+            {
+                if (value == levelNames[level] || value == to_string(level))
+                {
+                    options.logLevel = level;
+                }
+            }
+            if (options.logLevel == -1)
+            {
+                cerr << "Error: unknown log level " << value << "." << endl;
+                return false;
+            }
+        }
+        else if (name == "--log-format" && (value == "text" || value == "binary"))
+        {
+            options.binaryLog = value == "binary";
+        }
+        else if (name == "--log-file" && !value.empty())
+        {
+            options.logFile = value;
+        }
+        else if (arg == "--log-thread")
+        {
+            options.logThread = true;
+        }
+        else if (name == "--decode-log" && !value.empty())
+        {
+            options.decodeFile = value;
+        }
+        else if (name == "--decode-dump" && !value.empty())
+        {
+            options.decodeDumpFile = value;
+        }
+        else if (name == "--dump")
+        {
+            const char *formatNames[] = {"words", "runs", "binary"};
+            options.dumpFormat = -1;
+            for (int format = DUMP_WORDS; format <= DUMP_BINARY; format++)
+            {
+                if (value == formatNames[format])
+                {
+                    options.dumpFormat = format;
+                }
+            }
+            if (options.dumpFormat == -1)
+            {
+                cerr << "Error: unknown dump format " << value << "." << endl;
+                return false;
+            }
+        }
+        else if (name == "--dump-at" && !value.empty())
+        {
+            options.dumpAtStart = false;
+            options.dumpTimes.clear();
+            for (size_t start = 0; value != "none" && start <= value.size();)
+            {
+                size_t comma = min(value.find(',', start), value.size());
+                const char *first = value.data() + start;
+                const char *last = value.data() + comma;
+                int time = -1;
+                if (string(first, last) == "start")
+                {
+                    options.dumpAtStart = true;
+                }
+                else if (first == last || from_chars(first, last, time).ptr != last || time < 0)
+                {
+                    cerr << "Error: --dump-at needs start, none or clock times." << endl;
+                    return false;
+                }
+                else
+                {
+                    options.dumpTimes.push_back(time);
+                }
+                start = comma + 1;
+            }
+            sort(options.dumpTimes.begin(), options.dumpTimes.end());
+        }
+        else if (name == "--dump-file" && !value.empty())
+        {
+            options.dumpFile = value;
+        }
+        else if (name == "--input" && !value.empty())
+        {
+            options.inputFile = value;
+        }
+        else if (arg == "--preload-jobs")
+        {
+            options.preloadJobs = true;
+        }
+        else if (arg == "--segmented")
+        {
+            options.segmented = true;
+        }
+        else if (arg == "--paged")
+        {
+            options.paged = true;
+        }
+        else if (name == "--replacement")
+        {
+            options.replacement = -1;
+            for (int policy = 0; policy < NUM_REPLACEMENT_POLICIES; policy++)
+            {
+                if (value == replacementNames[policy])
+                {
+                    options.replacement = policy;
+                }
+            }
+            if (options.replacement == -1)
+            {
+                cerr << "Error: unknown replacement policy " << value << "." << endl;
+                return false;
+            }
+        }
+        else if (name == "--swap-file" && !value.empty())
+        {
+            options.swapFile = value;
+        }
+        else if (name == "--scheduler")
+        {
+            options.policy = -1;
+            for (int policy = 0; policy < NUM_SCHEDULING_POLICIES; policy++)
+            {
+                if (value == policyNames[policy])
+                {
+                    options.policy = policy;
+                }
+            }
+            if (options.policy == -1)
+            {
+                cerr << "Error: unknown scheduler " << value << "." << endl;
+                return false;
+            }
+            options.reportSchedule = true;
+        }
+        else if (name == "--priorities" && !value.empty())
+        {
+            options.prioritiesFile = value;
+        }
+        else if (name == "--cores")
+        {
+            options.cores = atoi(value.c_str());
+            if (options.cores < 1 || options.cores > 1024)
+            {
+                cerr << "Error: core count must be between 1 and 1024." << endl;
+                return false;
+            }
+        }
+        else if (name == "--steal-seed" && !value.empty())
+        {
+            options.stealSeed = strtoull(value.c_str(), NULL, 10);
+        }
+        else if (name == "--sweep-memory" || name == "--sweep-quantum" || name == "--sweep-switch")
+        {
+            vector<int> &values = name == "--sweep-memory" ? options.sweepMemory
+                                  : name == "--sweep-quantum" ? options.sweepQuantum : options.sweepSwitch;
+            if (!parseList(value, values))
+            {
+                cerr << "Error: " << name << " needs a comma separated list of non-negative integers." << endl;
+                return false;
+            }
+            options.sweep = true;
+        }
+        else if (name == "--generate" || name == "--bench")
+        {
+            (name == "--generate" ? options.generate : options.bench) = true;
+            if (!parseWorkloadSpec(value, options.workload))
+            {
+                cerr << "Error: malformed workload spec " << value << "." << endl;
+                return false;
+            }
+        }
+        else if (name == "--checkpoint" && !value.empty())
+        {
+            options.checkpointFile = value;
+        }
+        else if (name == "--metrics" && !value.empty())
+        {
+            options.metricsFile = value;
+        }
+        else if (name == "--metrics-format" && (value == "json" || value == "csv"))
+        {
+            options.metricsJson = value == "json";
+        }
+        else if (name == "--metrics-interval")
+        {
+            options.metricsInterval = atoi(value.c_str());
+            if (options.metricsInterval < 1)
+            {
+                cerr << "Error: metrics interval must be positive." << endl;
+                return false;
+            }
+        }
+        else if (name == "--restore" && !value.empty())
+        {
+            options.restoreFile = value;
+        }
+        else if (name == "--checkpoint-every" || name == "--quantum" || name == "--switch-time" ||
+                 name == "--compact" || name == "--backfill" || name == "--backfill-wait" ||
+                 name == "--page-size" || name == "--working-set" || name == "--page-fault-time" ||
+                 name == "--bulk-words")
+        {
+            int &target = name == "--checkpoint-every"  ? options.checkpointEvery
+                          : name == "--quantum"         ? options.quantumOverride
+                          : name == "--switch-time"     ? options.switchOverride
+                          : name == "--backfill"        ? options.backfillWindow
+                          : name == "--backfill-wait"   ? options.backfillWait
+                          : name == "--page-size"       ? options.pageSize
+                          : name == "--working-set"     ? options.workingSetWindow
+                          : name == "--page-fault-time" ? options.pageFaultTime
+                          : name == "--bulk-words"      ? options.bulkWords
+                                                        : options.compactWords;
+            from_chars_result parsed = from_chars(value.data(), value.data() + value.size(), target);
+            if (value.empty() || parsed.ec != errc() || parsed.ptr != value.data() + value.size() || target < 0)
+            {
+                cerr << "Error: " << name << " needs a non-negative integer." << endl;
+                return false;
+            }
+        }
+        else if (name == "--threads")
+        {
+            options.threads = atoi(value.c_str());
+            if (options.threads < 1)
+            {
+                cerr << "Error: thread count must be positive." << endl;
+                return false;
+            }
+        }
+        else
+        {
+            cerr << "Error: unknown option " << arg << "." << endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (options.dumpFormat == DUMP_BINARY && options.dumpFile.empty())
+    {
+        cerr << "Error: --dump=binary needs --dump-file." << endl;
+        return false;
+    }
+    if (options.paged && (options.segmented || options.compactWords > 0))
+    {
+        cerr << "Error: --paged cannot be combined with --segmented or --compact." << endl;
+        return false;
+    }
+    if (options.pageSize < PCB_SIZE)
+    {
+        cerr << "Error: page size must be at least " << PCB_SIZE << " words." << endl;
+        return false;
+    }
+    if (options.bulkWords < 1)
+    {
+        cerr << "Error: --bulk-words must be positive." << endl;
+        return false;
+    }
+    return true;
+}
+
+// Checkpoint file layout: the magic string, the offset of the main memory
+// image, the serialized simulator state and, at that page aligned offset,
+// main memory itself. Pages of memory that are still untouched or were
+// freed are all zero and are left as holes in the file, and restoring
+// reads back only the data around them, so the size of a checkpoint
+// follows the words in use rather than the size of the address space
+const char CHECKPOINT_MAGIC[8] = {'O', 'S', 'S', 'I', 'M', 'C', 'K', '1'};
+const size_t CHECKPOINT_ALIGNMENT = 4096;
+
+// Set by SIGUSR1 to ask for a checkpoint at the next scheduling decision
+volatile sig_atomic_t checkpointRequested = 0;
+
+void requestCheckpoint(int)
+{
+    checkpointRequested = 1;
+}
+
+// Set by SIGUSR2 to ask for a memory dump at the next scheduling decision
+volatile sig_atomic_t dumpRequested = 0;
+
+void requestDump(int)
+{
+    dumpRequested = 1;
+}
+
+// Serialized checkpoint state, values are stored in host byte order
+struct checkpointWriter
+{
+    string data;
+
+    template <typename T>
+    void put(const T &value)
+    {
+        data.append((const char *)&value, sizeof(T));
+    }
+    template <typename T>
+    void putVector(const vector<T> &values)
+    {
+        put((long long)values.size());
+        data.append((const char *)values.data(), values.size() * sizeof(T));
+    }
+};
+
+struct checkpointReader
+{
+    const char *cursor;
+    const char *end;
+    bool failed = false;
+
+    template <typename T>
+    void get(T &value)
+    {
+        if (failed || end - cursor < (ptrdiff_t)sizeof(T))
+        {
+            failed = true;
+            return;
+        }
+        memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+    }
+    template <typename T>
+    void getVector(vector<T> &values)
+    {
+        long long count;
+        get(count);
+        if (failed || count < 0 || count > (end - cursor) / (long long)sizeof(T))
+        {
+            failed = true;
+            values.clear();
+            return;
+        }
+        values.clear();
+        values.reserve(count);
+        for (long long i = 0; i < count; i++)
+        {
+            alignas(T) char element[sizeof(T)]; // the stream is not aligned
+            memcpy(element, cursor, sizeof(T));
+            values.push_back(*(const T *)element);
+            cursor += sizeof(T);
+        }
+    }
+};
+
+void putJob(checkpointWriter &out, const PCB &job)
+{
+    out.put(job.processID);
+    out.put(job.maxMemoryNeeded);
+    out.put(job.instructionSize);
+    out.putVector(job.logicalMemory);
+}
+
+void getJob(checkpointReader &in, PCB &job)
+{
+    in.get(job.processID);
+    in.get(job.maxMemoryNeeded);
+    in.get(job.instructionSize);
+    in.getVector(job.logicalMemory);
+    job.state = 1;
+    job.programCounter = 0;
+    job.cpuCyclesUsed = 0;
+    job.registerValue = 0;
+    job.startTime = -1;
+    job.endTime = -1;
+    job.memoryLimit = job.maxMemoryNeeded;
+}
+
+void putIndex(checkpointWriter &out, const hashIndex &index)
+{
+    out.putVector(index.keys);
+    out.putVector(index.values);
+    out.put(index.count);
+}
+
+void getIndex(checkpointReader &in, hashIndex &index)
+{
+    in.getVector(index.keys);
+    in.getVector(index.values);
+    in.get(index.count);
+    if (index.keys.size() != index.values.size() || (index.keys.size() & (index.keys.size() - 1)) != 0)
+    {
+        in.failed = true;
+    }
+}
+
+// System state sampled every metrics interval
+struct metricsSample
+{
+    int clock;
+    long long ready;      // processes in every ready queue
+    long long waitingIO;
+    long long pending;    // jobs not loaded yet
+    long long resident;
+    long long freeWords;
+    long long largestFree;
+    long long busyCycles; // all cores, since the start of the run
+    long long coreCycles; // sum of the core clocks, busy or not
+};
+
+// Distribution of one per-process time
+// Histogram bucket 0 counts zeros, bucket k values from 2^(k-1) to 2^k - 1
+struct metricsSummary
+{
+    long long count = 0;
+    long long total = 0;
+    long long p50 = 0, p90 = 0, p95 = 0, p99 = 0, maximum = 0;
+    vector<long long> histogram;
+};
+
+// Function to summarize a set of times, percentiles use the nearest rank
+metricsSummary summarizeTimes(vector<long long> values)
+{
+    metricsSummary summary;
+    sort(values.begin(), values.end());
+    summary.count = values.size();
+    if (values.empty())
+    {
+        return summary;
+    }
+    auto percentile = [&](int p) { return values[(values.size() * p + 99) / 100 - 1]; };
+    summary.p50 = percentile(50);
+    summary.p90 = percentile(90);
+    summary.p95 = percentile(95);
+    summary.p99 = percentile(99);
+    summary.maximum = values.back();
+    for (long long value : values)
+    {
+        summary.total += value;
+        size_t bucket = value <= 0 ? 0 : 64 - __builtin_clzll(value);
+        if (bucket >= summary.histogram.size())
+        {
+            summary.histogram.resize(bucket + 1, 0);
+        }
+        summary.histogram[bucket]++;
+    }
+    return summary;
+}
+
+// Summary of a finished simulation, one row of a sweep
+struct simulationResult
+{
+    int maxMemory;
+    int CPUAllocated;
+    int switchTime;
+    long long totalTime;
+    long long completed;
+    long long totalTurnaround;
+    long long totalResponse;
+    long long pageFaults;
+};
+
+// One simulation: its configuration and every piece of simulator state
+// The free functions still take the parts they use by reference, and
+// logEvent writes to the log of the simulation running on the calling thread
+struct simulation
+{
+    int maxMemory;
+    int CPUAllocated;
+    int switchTime;
+    int policy = SCHEDULE_ROUND_ROBIN;
+    bool reportSchedule = false;
+    eventLog log;
+    memoryAllocator memoryList;
+    processTable processes; // Resident processes keyed by PID
+    memoryWord *mainMemory = NULL;
+    size_t memoryBytes = 0; // size of the main memory mapping
+    char *checkpointMapping = NULL; // restored checkpoint
+    size_t checkpointSize = 0;
+    bool restored = false;
+    vector<cpuCore> cores;
+    unsigned long long stealState = 1;
+    ioTimerQueue ioWaitQueue;
+    jobQueue newJobQueue;
+    compactionState compaction;
+    pagingState paging;
+    sharingState sharing;
+    bulkMemoryState bulk;
+    string metricsFile;
+    bool metricsJson = true;
+    int metricsInterval = 0;     // 0 when metrics are off
+    long long nextSample = 0;
+    vector<processMetrics> finishedProcesses;
+    vector<metricsSample> samples;
+    int dumpFormat = DUMP_WORDS;
+    bool dumpAtStart = true;
+    vector<int> dumpTimes;
+    size_t nextDump = 0; // first of dumpTimes not reached yet
+    string dumpFile;
+    FILE *dumpOut = NULL;
+    int globalClock = 0;
+    int totalCpuTime = 0;
+    string checkpointFile;       // where checkpoints are written, none if empty
+    int checkpointEvery = 0;     // clock cycles between periodic checkpoints, 0 for none
+    long long nextCheckpoint = 0;
+
+    simulation(const simulatorOptions &options, int maxMemory, int CPUAllocated, int switchTime,
+               const hashIndex &priorities)
+        : maxMemory(maxMemory), CPUAllocated(CPUAllocated), switchTime(switchTime), policy(options.policy),
+          reportSchedule(options.reportSchedule), cores(options.cores), stealState(options.stealSeed)
+    {
+        log.level = options.logLevel;
+        log.binary = options.binaryLog;
+        initMemoryAllocator(memoryList, maxMemory); // Initialize memory list with a single free block of size maxMemory
+        memoryList.segmented = options.segmented;
+        memoryList.sharing = &sharing;
+        sharing.pageSize = options.pageSize;
+        bulk.wordsPerCycle = options.bulkWords;
+        for (cpuCore &core : cores)
+        {
+            core.readyQueue.policy = options.policy;
+            core.readyQueue.processes = &processes;
+            core.readyQueue.priorities = priorities;
+        }
+        checkpointFile = options.checkpointFile;
+        checkpointEvery = options.checkpointEvery;
+        nextCheckpoint = checkpointEvery;
+        compaction.wordsPerTick = options.compactWords;
+        newJobQueue.window = options.backfillWindow;
+        newJobQueue.backfillWait = options.backfillWait;
+        dumpFormat = options.dumpFormat;
+        dumpAtStart = options.dumpAtStart;
+        dumpTimes = options.dumpTimes;
+        dumpFile = options.dumpFile;
+        if (!options.metricsFile.empty())
+        {
+            metricsFile = options.metricsFile;
+            metricsJson = options.metricsJson;
+            metricsInterval = options.metricsInterval;
+            for (cpuCore &core : cores)
+            {
+                core.readyQueue.finishedProcesses = &finishedProcesses;
+            }
+        }
+    }
+    simulation(const simulation &) = delete;
+    ~simulation()
+    {
+        if (dumpOut != NULL)
+        {
+            fclose(dumpOut);
+        }
+        if (checkpointMapping != NULL)
+        {
+            munmap(checkpointMapping, checkpointSize);
+        }
+        if (mainMemory != NULL)
+        {
+            munmap(mainMemory, memoryBytes);
+        }
+        closeSwap(paging);
+    }
+
+    // Function to switch main memory to demand paging with the given page size
+    // Returns false if memory holds too few frames or the swap file cannot be created
+    bool enablePaging(const simulatorOptions &options, int pageSize)
+    {
+        paging.pageSize = pageSize;
+        paging.faultTime = options.pageFaultTime;
+        paging.policy = options.replacement;
+        paging.workingSetWindow = options.workingSetWindow;
+        paging.frames = maxMemory / pageSize;
+        if (paging.frames < 3)
+        {
+            cerr << "Error: paged memory needs room for at least 3 pages of " << pageSize << " words." << endl;
+            return false;
+        }
+        if (!openSwap(paging, options.swapFile))
+        {
+            cerr << "Error: cannot create swap file " << options.swapFile << "." << endl;
+            return false;
+        }
+        memoryList.paging = &paging;
+        return true;
+    }
+
+    // Function to allocate main memory with every word free
+    // The mapping reserves no swap and the kernel only backs pages once
+    // they are written, so allocation costs the same for any memory size
+    void allocateMemory()
+    {
+        memoryBytes = max((size_t)maxMemory * sizeof(memoryWord), MEMORY_PAGE_SIZE);
+        void *mapping = mmap(NULL, memoryBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                             -1, 0);
+        if (mapping == MAP_FAILED)
+        {
+            throw bad_alloc();
+        }
+        mainMemory = (memoryWord *)mapping;
+        for (cpuCore &core : cores)
+        {
+            core.readyQueue.mainMemory = mainMemory;
+        }
+    }
+
+    bool saveCheckpoint(const string &path) const;
+    bool restoreCheckpoint(const string &path, const simulatorOptions &options);
+    bool writeMetrics() const;
+
+    // Function to dump main memory in the configured format
+    void dumpMemory(int clock)
+    {
+        if (dumpFormat == DUMP_WORDS)
+        {
+            for (int i = 0; log.level >= LOG_INSTRUCTIONS && i < maxMemory; i++)
+            {
+                logEvent(EVENT_MEMORY_WORD, clock, -1, {i, mainMemory[i]});
+            }
+            return;
+        }
+        if (dumpFormat == DUMP_RUNS && log.level < LOG_SUMMARY)
+        {
+            return;
+        }
+        vector<memoryRegion> regions;
+        vector<memoryRun> runs;
+        describeMemory(mainMemory, memoryList, processes, regions, runs);
+        if (dumpFormat == DUMP_RUNS)
+        {
+            logMemoryDump(clock, maxMemory, regions, runs);
+            return;
+        }
+        if (dumpOut == NULL)
+        {
+            dumpOut = fopen(dumpFile.c_str(), "wb");
+            if (dumpOut == NULL || fwrite(DUMP_MAGIC, 1, sizeof(DUMP_MAGIC), dumpOut) != sizeof(DUMP_MAGIC))
+            {
+                cerr << "Error: cannot write dump file " << dumpFile << "." << endl;
+                dumpFormat = DUMP_WORDS;
+                return;
+            }
+        }
+        if (!writeMemoryDump(dumpOut, clock, maxMemory, regions, runs))
+        {
+            cerr << "Error: cannot write dump file " << dumpFile << "." << endl;
+        }
+    }
+
+    // Function to record the queue depths and memory use at the given clock
+    void sampleMetrics(int clock)
+    {
+        metricsSample sample = {clock, 0, (long long)ioWaitQueue.size(), (long long)newJobQueue.pending(),
+                                processes.byProcessID.count, memoryList.freeWords, largestFreeSize(memoryList), 0, 0};
+        for (const cpuCore &core : cores)
+        {
+            sample.ready += core.readyQueue.size();
+            sample.busyCycles += core.busyCycles;
+            sample.coreCycles += core.clock;
+        }
+        samples.push_back(sample);
+    }
+
+    // Function to run the simulation until every job has terminated
+    void run()
+    {
+        eventLog *callerLog = activeLog;
+        activeLog = &log;
+
+        if (!restored)
+        {
+            if (mainMemory == NULL)
+            {
+                allocateMemory();
+            }
+            newJobQueue.fill(); // Preloads every job unless jobs are streamed
+            loadJobsToMemory(newJobQueue, cores[0].readyQueue, mainMemory, maxMemory, memoryList, processes,
+                             globalClock);
+
+            if (dumpAtStart)
+            {
+                dumpMemory(globalClock);
+            }
+        }
+
+        int coreCount = cores.size();
+        for (;;)
+        {
+            bool anyReady = false;
+            int current = 0; // the core furthest behind runs next
+            for (int i = 0; i < coreCount; i++)
+            {
+                anyReady = anyReady || !cores[i].readyQueue.empty();
+                if (cores[i].clock < cores[current].clock)
+                {
+                    current = i;
+                }
+            }
+            if (!anyReady && ioWaitQueue.empty() && newJobQueue.empty())
+            {
+                break;
+            }
+            // Dumps come before checkpoints, so a restored run does not repeat them
+            if (dumpRequested || (nextDump < dumpTimes.size() && cores[current].clock >= dumpTimes[nextDump]))
+            {
+                dumpRequested = 0;
+                dumpMemory(cores[current].clock);
+                while (nextDump < dumpTimes.size() && dumpTimes[nextDump] <= cores[current].clock)
+                {
+                    nextDump++;
+                }
+            }
+            if (!checkpointFile.empty() &&
+                (checkpointRequested || (checkpointEvery > 0 && cores[current].clock >= nextCheckpoint)))
+            {
+                checkpointRequested = 0;
+                flushLog();
+                if (!saveCheckpoint(checkpointFile))
+                {
+                    cerr << "Error: cannot write checkpoint " << checkpointFile << "." << endl;
+                }
+                if (checkpointEvery > 0)
+                {
+                    nextCheckpoint = ((long long)cores[current].clock / checkpointEvery + 1) * checkpointEvery;
+                }
+            }
+            if (metricsInterval > 0 && cores[current].clock >= nextSample)
+            {
+                sampleMetrics(cores[current].clock);
+                nextSample = ((long long)cores[current].clock / metricsInterval + 1) * metricsInterval;
+            }
+            cpuCore &core = cores[current];
+            if (compaction.wordsPerTick > 0 && !newJobQueue.empty())
+            {
+                int requiredSize = newJobQueue.front().maxMemoryNeeded +
+                                   (memoryList.segmented ? SEGMENTED_HEADER_SIZE : PCB_SIZE);
+                if (compaction.block != -1 || memoryList.freeWords >= requiredSize)
+                {
+                    core.clock += compactMemory(compaction, requiredSize, memoryList, mainMemory, processes, cores,
+                                                ioWaitQueue, core.clock);
+                    if (compaction.block == -1 && hasSufficientMemoryBlock(memoryList, requiredSize))
+                    {
+                        loadJobsToMemory(newJobQueue, core.readyQueue, mainMemory, maxMemory, memoryList, processes,
+                                         core.clock);
+                    }
+                }
+            }
+            if (core.readyQueue.empty() && anyReady)
+            {
+                stealWork(cores, current, stealState);
+            }
+
+            if (!core.readyQueue.empty())
+            {
+                core.clock += switchTime;
+                readyEntry next = core.readyQueue.pop();
+                int startAddress = next.startAddress;
+                processEntry &process = processes.entries[findProcessAt(processes, startAddress)];
+                process.waitingTime += max(0, core.clock - switchTime - next.readyTime);
+                if (process.lastCore != -1 && process.lastCore != current)
+                {
+                    core.migrations++;
+                }
+                process.lastCore = current;
+                core.dispatches++;
+                if (compaction.block != -1 && memoryList.blocks[compaction.block].processID == process.processID)
+                { // the rest of the process has to be in place before it runs
+                    int moved = continueRelocation(compaction, memoryList, mainMemory, INT_MAX);
+                    compaction.wordsMoved += moved;
+                    core.clock += moved;
+                }
+                logEvent(EVENT_RUNNING, core.clock, process.processID);
+                int burstStart = core.clock;
+                long long stalledBefore = paging.counters.stallCycles;
+                executeCPU(startAddress, mainMemory, core.readyQueue.timeSlice(startAddress, CPUAllocated), core.clock, ioWaitQueue, core.readyQueue, totalCpuTime, processes, memoryList, maxMemory, newJobQueue,
+                           bulk);
+                // Page fault stalls are not CPU work
+                core.busyCycles += core.clock - burstStart - (paging.counters.stallCycles - stalledBefore);
+                checkIOWaitingQueue(ioWaitQueue, core.clock, core.readyQueue, mainMemory, processes);
+                continue;
+            }
+
+            // Nothing to run here, so skip the idle context switches up to the
+            // first one at or after the next IO completion, or after the next
+            // core ahead of this one, which may have work to steal by then
+            long long wakeTime = ioWaitQueue.empty() ? LLONG_MAX : ioWaitQueue.nextCompletion();
+            for (int i = 0; i < coreCount; i++)
+            {
+                if (cores[i].clock > core.clock)
+                {
+                    wakeTime = min(wakeTime, (long long)cores[i].clock);
+                }
+            }
+            if (wakeTime != LLONG_MAX)
+            {
+                long long idle = wakeTime - core.clock;
+                if (switchTime > 0)
+                {
+                    long long switches = max(1LL, (idle + switchTime - 1) / switchTime);
+                    core.clock += switches * switchTime;
+                }
+                else if (idle > 0)
+                {
+                    core.clock += idle;
+                }
+                checkIOWaitingQueue(ioWaitQueue, core.clock, core.readyQueue, mainMemory, processes);
+            }
+            else
+            {
+                core.clock += switchTime;
+                loadJobsToMemory(newJobQueue, core.readyQueue, mainMemory, maxMemory, memoryList, processes, core.clock);
+            }
+        }
+        for (const cpuCore &core : cores)
+        {
+            globalClock = max(globalClock, core.clock);
+        }
+
+        globalClock += switchTime;
+        logEvent(EVENT_TOTAL_TIME, globalClock, -1);
+        if (memoryList.segmented)
+        {
+            logEvent(EVENT_TRANSLATION_STATS, globalClock, -1,
+                     {processes.translationStats.segmentHits, processes.translationStats.cacheHits, processes.translationStats.misses});
+        }
+        if (reportSchedule)
+        {
+            long long completed = 0, totalTurnaround = 0, totalResponse = 0;
+            for (const cpuCore &core : cores)
+            {
+                completed += core.readyQueue.completed;
+                totalTurnaround += core.readyQueue.totalTurnaround;
+                totalResponse += core.readyQueue.totalResponse;
+            }
+            logEvent(EVENT_SCHEDULE_REPORT, globalClock, -1, {policy, completed, totalTurnaround, totalResponse});
+        }
+        if (compaction.wordsPerTick > 0)
+        {
+            logEvent(EVENT_COMPACTION_REPORT, globalClock, -1, {compaction.relocations, compaction.wordsMoved});
+        }
+        if (memoryList.paging != NULL)
+        {
+            const pagingCounters &counters = paging.counters;
+            logEvent(EVENT_PAGING_REPORT, globalClock, -1,
+                     {paging.policy, paging.pageSize, counters.references, counters.faults, counters.swapIns,
+                      counters.swapOuts, counters.evictions, counters.stallCycles});
+        }
+        if (sharing.counters.forks + sharing.counters.failedForks > 0)
+        {
+            const sharingCounters &counters = sharing.counters;
+            logEvent(EVENT_FORK_REPORT, globalClock, -1,
+                     {counters.forks, counters.failedForks, counters.faults, counters.wordsCopied,
+                      counters.peakSharedWords});
+        }
+        if (bulk.instructions > 0)
+        {
+            logEvent(EVENT_BULK_REPORT, globalClock, -1, {bulk.instructions, bulk.words, bulk.cycles});
+        }
+        if (newJobQueue.window > 0)
+        {
+            logEvent(EVENT_BACKFILL_REPORT, globalClock, -1, {newJobQueue.backfilled, newJobQueue.reservations});
+        }
+        for (int i = 0; coreCount > 1 && i < coreCount; i++)
+        {
+            const cpuCore &core = cores[i];
+            logEvent(EVENT_CORE_REPORT, globalClock, -1,
+                     {i, core.busyCycles, core.dispatches, core.steals, core.migrations});
+        }
+        flushLog();
+        activeLog = callerLog;
+
+        if (metricsInterval > 0)
+        {
+            sampleMetrics(globalClock);
+            if (!writeMetrics())
+            {
+                cerr << "Error: cannot write metrics to " << metricsFile << "." << endl;
+            }
+        }
+    }
+
+    simulationResult result() const
+    {
+        simulationResult row = {maxMemory, CPUAllocated, switchTime, globalClock, 0, 0, 0, paging.counters.faults};
+        for (const cpuCore &core : cores)
+        {
+            row.completed += core.readyQueue.completed;
+            row.totalTurnaround += core.readyQueue.totalTurnaround;
+            row.totalResponse += core.readyQueue.totalResponse;
+        }
+        return row;
+    }
+};
+
+// Function to write the whole simulator state to a checkpoint file
+// It is written next to path and renamed over it, so an existing checkpoint
+// is never left half written
+// Returns false if the file cannot be written
+bool simulation::saveCheckpoint(const string &path) const
+{
+    checkpointWriter out;
+    out.data.append(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    out.put(0LL); // main memory offset, filled in once the state is written
+    out.put(maxMemory);
+    out.put(CPUAllocated);
+    out.put(switchTime);
+    out.put(policy);
+    out.put(globalClock);
+    out.put(totalCpuTime);
+    out.put(stealState);
+
+    out.putVector(memoryList.blocks);
+    out.putVector(memoryList.unusedBlocks);
+    out.put(memoryList.firstBlock);
+    out.put(memoryList.freeLists);
+    out.put(memoryList.nonEmptyClasses);
+    out.put(memoryList.freeTree);
+    out.putVector(memoryList.uncoalesced);
+    out.put(memoryList.segmented);
+    out.put(memoryList.freeWords);
+    out.put(compaction);
+    out.put(memoryList.paging != NULL);
+    if (memoryList.paging != NULL)
+    { // swap is saved with the state, the slots in use are the ones below usedSlots
+        out.put(paging.pageSize);
+        out.put(paging.pinnedFrames);
+        out.putVector(paging.resident);
+        out.put(paging.hand);
+        out.put(paging.usedSlots);
+        out.putVector(paging.freeSlots);
+        out.put(paging.counters);
+        out.data.append((const char *)paging.swap, (size_t)paging.usedSlots * paging.pageSize * sizeof(memoryWord));
+    }
+    out.put(sharing);
+    out.put(bulk);
+
+    out.put((long long)processes.entries.size());
+    for (const processEntry &process : processes.entries)
+    {
+        out.put(process.processID);
+        out.put(process.blocks);
+        out.put(process.blockCount);
+        out.put(process.segmentTable);
+        out.putVector(process.translation.segmentStarts);
+        out.putVector(process.translation.segmentEnds);
+        out.put(process.translation.lastSegment);
+        out.put(process.translation.cachedLogical);
+        out.put(process.translation.cachedPhysical);
+        out.putVector(process.translation.pages);
+        out.put(process.translation.sharedSize);
+        out.put(process.mainMemoryBase);
+        out.put(process.loadTime);
+        out.put(process.startTime);
+        out.put(process.endTime);
+        out.put(process.priority);
+        out.put(process.queueLevel);
+        out.put(process.lastCore);
+        out.put(process.waitingTime);
+        out.putVector(process.dataOffsets);
+        out.putVector(process.program);
+    }
+    out.putVector(processes.unusedSlots);
+    putIndex(out, processes.byProcessID);
+    putIndex(out, processes.byBaseAddress);
+    out.put(processes.translationStats);
+
+    // Ready queues are stored in the order they would be dispatched
+    out.put((int)cores.size());
+    for (const cpuCore &core : cores)
+    {
+        const scheduler &readyQueue = core.readyQueue;
+        for (int level = 0; level < MLFQ_LEVELS; level++)
+        {
+            out.putVector(vector<readyEntry>(readyQueue.levels[level].begin(), readyQueue.levels[level].end()));
+        }
+        vector<readyEntry> heapEntries;
+        for (auto heap = readyQueue.heap; !heap.empty(); heap.pop())
+        {
+            heapEntries.push_back(heap.top());
+        }
+        out.putVector(heapEntries);
+        out.put(readyQueue.nextSequence);
+        putIndex(out, readyQueue.priorities);
+        out.put(readyQueue.completed);
+        out.put(readyQueue.totalTurnaround);
+        out.put(readyQueue.totalResponse);
+        out.put(core.clock);
+        out.put(core.busyCycles);
+        out.put(core.dispatches);
+        out.put(core.steals);
+        out.put(core.migrations);
+    }
+
+    vector<IOWaitEntry> ioEntries;
+    for (auto waiting = ioWaitQueue.waiting; !waiting.empty(); waiting.pop())
+    {
+        ioEntries.push_back(waiting.top());
+    }
+    out.putVector(ioEntries);
+    out.put(ioWaitQueue.nextSequence);
+    out.putVector(finishedProcesses);
+    out.putVector(samples);
+    out.put(nextSample);
+
+    // Jobs parsed but not loaded yet, then the input position after them
+    out.put((long long)newJobQueue.parsedCount);
+    for (size_t i = 0; i < newJobQueue.parsedCount; i++)
+    {
+        putJob(out, newJobQueue.parsedJob(i));
+    }
+    out.put((long long)newJobQueue.nextJob);
+    out.put(newJobQueue.poppedJobs);
+    out.putVector(newJobQueue.taken);
+    out.put(newJobQueue.blockedJob);
+    out.put(newJobQueue.blockedSince);
+    out.put(newJobQueue.reserved);
+    out.put(newJobQueue.backfilled);
+    out.put(newJobQueue.reservations);
+    const jobReader *reader = newJobQueue.reader;
+    out.put(reader != NULL);
+    out.put(reader != NULL ? readerOffset(*reader) : 0LL);
+    out.put(reader != NULL ? reader->jobsLeft : 0LL);
+
+    long long memoryOffset = (out.data.size() + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+    memcpy(&out.data[sizeof(CHECKPOINT_MAGIC)], &memoryOffset, sizeof(memoryOffset));
+    out.data.resize(memoryOffset, 0);
+
+    string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool written = fwrite(out.data.data(), 1, out.data.size(), file) == out.data.size();
+    // Free blocks hold only -1 (zero bytes), so only the other blocks are
+    // written and the file is extended past the last one
+    for (int index = memoryList.firstBlock; written && index != -1; index = memoryList.blocks[index].nextBlock)
     {
-        processStartTimes[processID - 1] = globalClock;
+        const memoryBlock &block = memoryList.blocks[index];
+        if (block.processID != -1)
+        {
+            written = fseeko(file, memoryOffset + (off_t)block.startingAddress * sizeof(memoryWord), SEEK_SET) == 0 &&
+                      fwrite(mainMemory + block.startingAddress, sizeof(memoryWord), block.size, file) ==
+                          (size_t)block.size;
+        }
     }
-    mainMemory[startAddress + 1] = 2; // Running state
-    int burstCycles = 0;
-    int instructionSize = dataBase - instructionBase;
-    int dataOffset = 0;
+    written = written && fflush(file) == 0 &&
+              ftruncate(fileno(file), memoryOffset + (off_t)maxMemory * sizeof(memoryWord)) == 0;
+    written = fclose(file) == 0 && written;
+    return written && rename(temporary.c_str(), path.c_str()) == 0;
+}
 
-    for (int i = 0; i < programCounter-1; i++)
-    { // Update data offset for all instructions before current program counter - 1
-        if (mainMemory[instructionBase + i] == 1 || mainMemory[instructionBase + i] == 3)
+// Function to resume from a checkpoint written by saveCheckpoint
+// The state is read through a mapping of the file and main memory is read
+// into a fresh allocation one data extent at a time, skipping the holes.
+// Logging and checkpoint options come from the command line, as do the
+// scheduler, quantum and switch time when they are given, so one checkpoint
+// can branch into several differently configured runs; the ready processes
+// of the saved policy are handed to the new one in their dispatch order.
+// The job input must be the same file the checkpointed run read
+// Returns false if the file is missing or is not a valid checkpoint
+bool simulation::restoreCheckpoint(const string &path, const simulatorOptions &options)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size >= (off_t)(sizeof(CHECKPOINT_MAGIC) + sizeof(long long)))
+    {
+        mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (mapping == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    checkpointMapping = (char *)mapping;
+    checkpointSize = info.st_size;
+    checkpointReader in = {checkpointMapping, checkpointMapping + checkpointSize};
+    if (memcmp(in.cursor, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    in.cursor += sizeof(CHECKPOINT_MAGIC);
+    long long memoryOffset;
+    int savedPolicy;
+    in.get(memoryOffset);
+    in.get(maxMemory);
+    in.get(CPUAllocated);
+    in.get(switchTime);
+    in.get(savedPolicy);
+    in.get(globalClock);
+    in.get(totalCpuTime);
+    in.get(stealState);
+    if (in.failed || maxMemory < 0 || memoryOffset < in.cursor - checkpointMapping ||
+        memoryOffset % CHECKPOINT_ALIGNMENT != 0 ||
+        memoryOffset + (long long)maxMemory * (long long)sizeof(memoryWord) > (long long)checkpointSize)
+    {
+        close(fd);
+        return false;
+    }
+    in.end = checkpointMapping + memoryOffset;
+    allocateMemory();
+    off_t memoryEnd = memoryOffset + (off_t)maxMemory * sizeof(memoryWord);
+    bool loaded = true;
+    for (off_t position = memoryOffset; loaded && position < memoryEnd;)
+    {
+        // Without SEEK_DATA support the whole image counts as one extent
+        off_t data = lseek(fd, position, SEEK_DATA);
+        if (data < 0 && errno == ENXIO)
         {
-            dataOffset += 2;
+            break; // only holes are left
         }
-        else if (mainMemory[instructionBase + i] == 2 || mainMemory[instructionBase + i] == 4)
+        off_t hole = data < 0 ? memoryEnd : lseek(fd, data, SEEK_HOLE);
+        data = data < 0 ? position : data;
+        hole = hole < 0 ? memoryEnd : min(hole, memoryEnd);
+        for (position = data; loaded && position < hole;)
         {
-            dataOffset += 1;
+            ssize_t count = pread(fd, (char *)mainMemory + (position - memoryOffset), hole - position, position);
+            loaded = count > 0;
+            position += count;
         }
     }
+    close(fd);
+    if (!loaded)
+    {
+        return false;
+    }
 
-    while (programCounter < instructionSize && burstCycles < CPUAllocated)
+    in.getVector(memoryList.blocks);
+    in.getVector(memoryList.unusedBlocks);
+    in.get(memoryList.firstBlock);
+    in.get(memoryList.freeLists);
+    in.get(memoryList.nonEmptyClasses);
+    in.get(memoryList.freeTree);
+    in.getVector(memoryList.uncoalesced);
+    in.get(memoryList.segmented);
+    in.get(memoryList.freeWords);
+    int compactWords = compaction.wordsPerTick;
+    in.get(compaction);
+    if (options.compactWords > 0)
     {
-        int prevProgramCounter = instructionBase + programCounter - 1; // Update data offset for current program counter - 1
-                                                                       // (data now ready for program counter)
-        if (mainMemory[prevProgramCounter] == 1 || mainMemory[prevProgramCounter] == 3)
+        compaction.wordsPerTick = compactWords;
+    }
+    bool paged = false;
+    in.get(paged);
+    if (paged)
+    { // a paged checkpoint resumes paged, with the replacement options of the command line
+        int pageSize = 0;
+        in.get(pageSize);
+        if (in.failed || pageSize < PCB_SIZE || !enablePaging(options, pageSize))
         {
-            dataOffset += 2;
+            return false;
         }
-        else if (mainMemory[prevProgramCounter] == 2 || mainMemory[prevProgramCounter] == 4)
+        in.get(paging.pinnedFrames);
+        in.getVector(paging.resident);
+        in.get(paging.hand);
+        in.get(paging.usedSlots);
+        in.getVector(paging.freeSlots);
+        in.get(paging.counters);
+        size_t swapBytes = (size_t)paging.usedSlots * pageSize * sizeof(memoryWord);
+        if (in.failed || paging.usedSlots < 0 || (size_t)(in.end - in.cursor) < swapBytes)
         {
-            dataOffset += 1;
+            return false;
         }
-
-        int instruction = mainMemory[instructionBase + programCounter];
-        instructionSize = dataBase - instructionBase;
-        switch (instruction)
+        if (swapBytes > 0)
         {
-        case 1:
-        { // Compute: 1 iterations cycles
-            int iterations = mainMemory[dataBase + dataOffset];
-            int cycles = mainMemory[dataBase + dataOffset + 1];
-            // cout << "instructionBase: " << instructionBase << endl;
-            // cout << "Prog count: " << programCounter << endl;
-            // cout << "iterations:" << iterations << endl;
+            reserveSwap(paging, paging.usedSlots);
+            memcpy(paging.swap, in.cursor, swapBytes);
+            in.cursor += swapBytes;
+        }
+    }
+    in.get(sharing);
+    in.get(bulk);
+    if (in.failed || sharing.pageSize < PCB_SIZE || bulk.wordsPerCycle < 1)
+    {
+        return false;
+    }
 
-            //  cout << "Cycles:" << cycles << endl;
-            cout << "compute" << endl;
-            cpuCyclesUsed += cycles;
-            globalClock += cycles;
-            burstCycles += cycles;
-            programCounter += 1;
-            break;
+    long long processCount;
+    in.get(processCount);
+    if (in.failed || processCount < 0 || processCount > maxMemory)
+    {
+        return false;
+    }
+    processes.entries.resize(processCount);
+    for (processEntry &process : processes.entries)
+    {
+        in.get(process.processID);
+        in.get(process.blocks);
+        in.get(process.blockCount);
+        in.get(process.segmentTable);
+        in.getVector(process.translation.segmentStarts);
+        in.getVector(process.translation.segmentEnds);
+        in.get(process.translation.lastSegment);
+        in.get(process.translation.cachedLogical);
+        in.get(process.translation.cachedPhysical);
+        in.getVector(process.translation.pages);
+        in.get(process.translation.sharedSize);
+        process.translation.counters = &processes.translationStats;
+        process.translation.paging = process.translation.pages.empty() ? NULL : memoryList.paging;
+        process.translation.sharing = process.translation.pages.empty() || memoryList.paging != NULL ? NULL : &sharing;
+        in.get(process.mainMemoryBase);
+        in.get(process.loadTime);
+        in.get(process.startTime);
+        in.get(process.endTime);
+        in.get(process.priority);
+        in.get(process.queueLevel);
+        in.get(process.lastCore);
+        in.get(process.waitingTime);
+        in.getVector(process.dataOffsets);
+        in.getVector(process.program);
+    }
+    in.getVector(processes.unusedSlots);
+    getIndex(in, processes.byProcessID);
+    getIndex(in, processes.byBaseAddress);
+    in.get(processes.translationStats);
+
+    int coreCount;
+    in.get(coreCount);
+    if (in.failed || coreCount < 1 || coreCount > 1024)
+    {
+        return false;
+    }
+    hashIndex priorities = cores[0].readyQueue.priorities;
+    cores.assign(coreCount, cpuCore());
+    vector<vector<readyEntry>> readyEntries(coreCount);
+    for (int i = 0; i < coreCount; i++)
+    {
+        cpuCore &core = cores[i];
+        scheduler &readyQueue = core.readyQueue;
+        vector<readyEntry> entries;
+        for (int level = 0; level < MLFQ_LEVELS; level++)
+        {
+            in.getVector(entries);
+            readyQueue.levels[level].assign(entries.begin(), entries.end());
         }
-        case 2:
-        { // Print: 2 cycles
-            int ioCycles = mainMemory[dataBase + dataOffset];
-            cout << "Process " << processID << " issued an IOInterrupt and moved to the IOWaitingQueue." << endl;
-            mainMemory[startAddress + 1] = 4;
-            mainMemory[startAddress + 2] = programCounter + 1; // point to next
-
-            cpuCyclesUsed += ioCycles;
-            mainMemory[startAddress + 6] = cpuCyclesUsed;
-            mainMemory[startAddress + 7] = registerValue;
-            cpuCyclesUsed += ioCycles;
-            // burstCycles += ioCycles;
-            ioWaitQueue.push({startAddress, globalClock, ioCycles});
-            return;
+        in.getVector(readyEntries[i]);
+        in.get(readyQueue.nextSequence);
+        getIndex(in, readyQueue.priorities);
+        in.get(readyQueue.completed);
+        in.get(readyQueue.totalTurnaround);
+        in.get(readyQueue.totalResponse);
+        in.get(core.clock);
+        in.get(core.busyCycles);
+        in.get(core.dispatches);
+        in.get(core.steals);
+        in.get(core.migrations);
+        readyQueue.policy = savedPolicy;
+        readyQueue.processes = &processes;
+        readyQueue.mainMemory = mainMemory;
+        readyQueue.finishedProcesses = metricsInterval > 0 ? &finishedProcesses : NULL;
+        if (!options.prioritiesFile.empty())
+        {
+            readyQueue.priorities = priorities;
         }
-        case 3:
-        { // Store: 3 value address
-            int value = mainMemory[dataBase + dataOffset];
-            int addressOffset = mainMemory[dataBase + dataOffset + 1];
+    }
 
-            int physicalAddress = instructionBase + addressOffset;
-            registerValue = value;
-            // cout << "New Register Value: " << registerValue << endl;
+    vector<IOWaitEntry> ioEntries;
+    in.getVector(ioEntries);
+    for (const IOWaitEntry &entry : ioEntries)
+    {
+        ioWaitQueue.waiting.push(entry);
+    }
+    in.get(ioWaitQueue.nextSequence);
+    in.getVector(finishedProcesses);
+    in.getVector(samples);
+    long long savedNextSample;
+    in.get(savedNextSample);
 
-            if (physicalAddress >= instructionBase && physicalAddress < instructionBase + maxMemoryNeeded)
-            {
-                mainMemory[physicalAddress] = registerValue;
-                // cout << "Value to be stored:  " << registerValue  << endl;
-                // cout << "Address to be stored " << physicalAddress << endl;
-                cout << "stored" << endl;
-            }
-            else
+    long long parsedCount;
+    long long nextJob;
+    bool streaming;
+    long long inputOffset;
+    long long jobsLeft;
+    in.get(parsedCount);
+    for (long long i = 0; i < parsedCount && !in.failed; i++)
+    {
+        getJob(in, newJobQueue.nextRecord());
+        newJobQueue.parsedCount++;
+    }
+    in.get(nextJob);
+    in.get(newJobQueue.poppedJobs);
+    in.getVector(newJobQueue.taken);
+    in.get(newJobQueue.blockedJob);
+    in.get(newJobQueue.blockedSince);
+    in.get(newJobQueue.reserved);
+    in.get(newJobQueue.backfilled);
+    in.get(newJobQueue.reservations);
+    newJobQueue.takenCount = count(newJobQueue.taken.begin(), newJobQueue.taken.end(), 1);
+    in.get(streaming);
+    in.get(inputOffset);
+    in.get(jobsLeft);
+    if (in.failed || in.end - in.cursor >= (ptrdiff_t)CHECKPOINT_ALIGNMENT) // only padding may be left
+    {
+        return false;
+    }
+    newJobQueue.nextJob = nextJob;
+    if (!streaming)
+    {
+        newJobQueue.reader = NULL;
+    }
+    else if (newJobQueue.reader == NULL || !seekJobReader(*newJobQueue.reader, inputOffset))
+    {
+        cerr << "Error: job input ends before the checkpointed position." << endl;
+        return false;
+    }
+    else
+    {
+        newJobQueue.reader->jobsLeft = jobsLeft;
+    }
+
+    // Branch: the heap entries are pushed back under the policy of the resumed run
+    policy = options.reportSchedule ? options.policy : savedPolicy;
+    for (int i = 0; i < coreCount; i++)
+    {
+        scheduler &readyQueue = cores[i].readyQueue;
+        if (policy == savedPolicy)
+        {
+            for (const readyEntry &entry : readyEntries[i])
             {
-                cout << "store error!" << endl;
+                readyQueue.heap.push(entry);
             }
-            cpuCyclesUsed += 1;
-            globalClock += 1;
-            burstCycles += 1;
-            programCounter += 1;
-            break;
+            continue;
+        }
+        for (int level = 0; level < MLFQ_LEVELS; level++)
+        {
+            readyEntries[i].insert(readyEntries[i].end(), readyQueue.levels[level].begin(),
+                                   readyQueue.levels[level].end());
+            readyQueue.levels[level].clear();
+        }
+        readyQueue.policy = policy;
+        for (const readyEntry &entry : readyEntries[i])
+        {
+            readyQueue.push(entry.startAddress, entry.readyTime);
         }
-        case 4:
-        { // Load: 4 address
-            int addressOffset = mainMemory[dataBase + dataOffset];
-            int physicalAddress = instructionBase + addressOffset;
+    }
+    if (options.quantumOverride >= 0)
+    {
+        CPUAllocated = options.quantumOverride;
+    }
+    if (options.switchOverride >= 0)
+    {
+        switchTime = options.switchOverride;
+    }
 
-            registerValue = mainMemory[physicalAddress];
-            // cout << "New Register Value: " << registerValue << endl;
+    long long clock = cores[0].clock;
+    for (const cpuCore &core : cores)
+    {
+        clock = min(clock, (long long)core.clock);
+    }
+    nextCheckpoint = checkpointEvery > 0 ? (clock / checkpointEvery + 1) * checkpointEvery : 0;
+    nextDump = upper_bound(dumpTimes.begin(), dumpTimes.end(), clock) - dumpTimes.begin();
+    nextSample = savedNextSample > 0 ? savedNextSample : (clock / max(metricsInterval, 1) + 1) * metricsInterval;
+    restored = true;
+    return true;
+}
 
-            if (physicalAddress >= instructionBase && physicalAddress < instructionBase + maxMemoryNeeded)
-            {
-                cout << "loaded" << endl;
-            }
-            else
+// Function to write the collected metrics
+// JSON goes to one file; CSV is split into PATH-processes.csv (one row per
+// process), PATH-samples.csv (one row per sample) and PATH-summary.csv
+// (metric, statistic, value rows: totals, percentiles and histogram buckets)
+// Returns false if a file cannot be written
+bool simulation::writeMetrics() const
+{
+    vector<long long> waiting, response, turnaround;
+    for (const processMetrics &process : finishedProcesses)
+    {
+        waiting.push_back(process.waiting);
+        response.push_back(process.firstRun - process.arrival);
+        turnaround.push_back(process.completion - process.arrival);
+    }
+    const char *timeNames[] = {"waiting", "response", "turnaround"};
+    metricsSummary summaries[] = {summarizeTimes(waiting), summarizeTimes(response), summarizeTimes(turnaround)};
+
+    long long busyCycles = 0;
+    for (const cpuCore &core : cores)
+    {
+        busyCycles += core.busyCycles;
+    }
+    double cpuUtilization = globalClock > 0 ? (double)busyCycles / ((double)globalClock * cores.size()) : 0;
+    auto memoryUtilization = [&](const metricsSample &sample)
+    {
+        return maxMemory > 0 ? (double)(maxMemory - sample.freeWords) / maxMemory : 0.0;
+    };
+    auto fragmentation = [](const metricsSample &sample)
+    {
+        return sample.freeWords > 0 ? 1.0 - (double)sample.largestFree / sample.freeWords : 0.0;
+    };
+    // Utilization since the previous sample; core clocks run ahead of the
+    // sample clock by different amounts, so busy cycles are compared with
+    // the cycles the cores actually advanced
+    auto intervalUtilization = [&](size_t i)
+    {
+        long long cycles = samples[i].coreCycles - (i == 0 ? 0 : samples[i - 1].coreCycles);
+        long long busy = samples[i].busyCycles - (i == 0 ? 0 : samples[i - 1].busyCycles);
+        return cycles > 0 ? (double)busy / cycles : 0.0;
+    };
+    double averageMemoryUtilization = 0, peakFragmentation = 0;
+    for (const metricsSample &sample : samples)
+    {
+        averageMemoryUtilization += memoryUtilization(sample) / samples.size();
+        peakFragmentation = max(peakFragmentation, fragmentation(sample));
+    }
+
+    if (metricsJson)
+    {
+        FILE *out = fopen(metricsFile.c_str(), "w");
+        if (out == NULL)
+        {
+            return false;
+        }
+        fprintf(out, "{\n  \"config\": {\"max_memory\": %d, \"cpu_allocated\": %d, \"switch_time\": %d, "
+                     "\"cores\": %zu, \"policy\": \"%s\", \"sample_interval\": %d},\n",
+                maxMemory, CPUAllocated, switchTime, cores.size(), policyNames[policy], metricsInterval);
+        fprintf(out, "  \"system\": {\"total_time\": %d, \"processes\": %zu, \"cpu_utilization\": %.4f, "
+                     "\"memory_utilization\": %.4f, \"peak_fragmentation\": %.4f},\n",
+                globalClock, finishedProcesses.size(), cpuUtilization, averageMemoryUtilization, peakFragmentation);
+        fprintf(out, "  \"summary\": {");
+        for (int i = 0; i < 3; i++)
+        {
+            const metricsSummary &summary = summaries[i];
+            fprintf(out, "%s\n    \"%s\": {\"count\": %lld, \"mean\": %.2f, \"p50\": %lld, \"p90\": %lld, "
+                         "\"p95\": %lld, \"p99\": %lld, \"max\": %lld, \"histogram\": [",
+                    i > 0 ? "," : "", timeNames[i], summary.count,
+                    summary.count > 0 ? (double)summary.total / summary.count : 0.0, summary.p50, summary.p90,
+                    summary.p95, summary.p99, summary.maximum);
+            for (size_t bucket = 0; bucket < summary.histogram.size(); bucket++)
             {
-                cout << "load error!" << endl;
+                fprintf(out, "%s{\"le\": %lld, \"count\": %lld}", bucket > 0 ? ", " : "",
+                        bucket == 0 ? 0LL : (1LL << bucket) - 1, summary.histogram[bucket]);
             }
-            cpuCyclesUsed += 1;
-            globalClock += 1;
-            burstCycles += 1;
-            programCounter += 1;
-            break;
+            fprintf(out, "]}");
         }
+        fprintf(out, "\n  },\n  \"processes\": [");
+        for (size_t i = 0; i < finishedProcesses.size(); i++)
+        {
+            const processMetrics &process = finishedProcesses[i];
+            fprintf(out, "%s\n    {\"pid\": %lld, \"arrival\": %d, \"first_run\": %d, \"completion\": %d, "
+                         "\"waiting\": %lld, \"response\": %d, \"turnaround\": %d}",
+                    i > 0 ? "," : "", process.processID, process.arrival, process.firstRun, process.completion,
+                    process.waiting, process.firstRun - process.arrival, process.completion - process.arrival);
         }
-        if (burstCycles >= CPUAllocated && programCounter < instructionSize)
+        fprintf(out, "\n  ],\n  \"samples\": [");
+        for (size_t i = 0; i < samples.size(); i++)
         {
-            mainMemory[startAddress + 1] = 1;
-            mainMemory[startAddress + 2] = programCounter;
-            mainMemory[startAddress + 6] = cpuCyclesUsed;
-            mainMemory[startAddress + 7] = registerValue; // Save updated registerValue
-            readyQueue.push(startAddress);
-            cout << "Process " << processID << " has a TimeOUT interrupt and is moved to the ReadyQueue." << endl;
-            return;
+            const metricsSample &sample = samples[i];
+            fprintf(out, "%s\n    {\"clock\": %d, \"ready\": %lld, \"io\": %lld, \"new\": %lld, \"resident\": %lld, "
+                         "\"free_words\": %lld, \"largest_free\": %lld, \"memory_utilization\": %.4f, "
+                         "\"fragmentation\": %.4f, \"cpu_utilization\": %.4f}",
+                    i > 0 ? "," : "", sample.clock, sample.ready, sample.waitingIO, sample.pending, sample.resident,
+                    sample.freeWords, sample.largestFree, memoryUtilization(sample), fragmentation(sample),
+                    intervalUtilization(i));
         }
+        fprintf(out, "\n  ]\n}\n");
+        return fclose(out) == 0;
     }
 
-    if (programCounter >= dataBase - instructionBase)
+    FILE *out = fopen((metricsFile + "-processes.csv").c_str(), "w");
+    if (out == NULL)
     {
-        programCounter = instructionBase - 1;
-        mainMemory[startAddress + 1] = 3;
-        mainMemory[startAddress + 2] = programCounter;
-        mainMemory[startAddress + 6] = cpuCyclesUsed;
-        mainMemory[startAddress + 7] = registerValue; // Save updated registerValue
-        int startTime = processStartTimes[processID - 1];
-        int endTime = globalClock;
-        totalCpuTime += cpuCyclesUsed;
-        cout << "Process ID: " << processID << endl;
-        cout << "State: TERMINATED" << endl;
-        cout << "Program Counter: " << programCounter << endl;
-        cout << "Instruction Base: " << instructionBase << endl;
-        cout << "Data Base: " << dataBase << endl;
-        cout << "Memory Limit: " << memoryLimit << endl;
-        cout << "CPU Cycles Used: " << cpuCyclesUsed << endl;
-        cout << "Register Value: " << registerValue << endl;
-        cout << "Max Memory Needed: " << maxMemoryNeeded << endl;
-        cout << "Main Memory Base: " << mainMemoryBase << endl;
-        cout << "Total CPU Cycles Consumed: " << (endTime - processStartTimes[processID - 1]) << endl;
-        cout << "Process " << processID << " terminated. Entered running state at: " << processStartTimes[processID - 1]
-             << ". Terminated at: " << endTime << ". Total Execution Time: " << (endTime - processStartTimes[processID - 1]) << "." << endl;
-        freeBlock(processID, memoryList, mainMemory);
-        loadJobsToMemory(newJobQueue, readyQueue, mainMemory, maxMemory, memoryList);
-        //printList(memoryList); // Debug output
-        //printNewJobQueue(newJobQueue); // Debug output
+        return false;
     }
-    else
+    fprintf(out, "pid,arrival,first_run,completion,waiting,response,turnaround\n");
+    for (const processMetrics &process : finishedProcesses)
     {
-        mainMemory[startAddress + 1] = 1;
-        mainMemory[startAddress + 2] = programCounter;
-        mainMemory[startAddress + 6] = cpuCyclesUsed;
-        mainMemory[startAddress + 7] = registerValue; // Save updated registerValue
-        readyQueue.push(startAddress);
-        cout << "Process " << processID << " has moved to Ready state." << endl;
+        fprintf(out, "%lld,%d,%d,%d,%lld,%d,%d\n", process.processID, process.arrival, process.firstRun,
+                process.completion, process.waiting, process.firstRun - process.arrival,
+                process.completion - process.arrival);
+    }
+    bool written = fclose(out) == 0;
+
+    out = fopen((metricsFile + "-samples.csv").c_str(), "w");
+    if (out == NULL)
+    {
+        return false;
+    }
+    fprintf(out, "clock,ready,io,new,resident,free_words,largest_free,memory_utilization,fragmentation,"
+                 "cpu_utilization\n");
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const metricsSample &sample = samples[i];
+        fprintf(out, "%d,%lld,%lld,%lld,%lld,%lld,%lld,%.4f,%.4f,%.4f\n", sample.clock, sample.ready,
+                sample.waitingIO, sample.pending, sample.resident, sample.freeWords, sample.largestFree,
+                memoryUtilization(sample), fragmentation(sample), intervalUtilization(i));
     }
+    written = fclose(out) == 0 && written;
+
+    out = fopen((metricsFile + "-summary.csv").c_str(), "w");
+    if (out == NULL)
+    {
+        return false;
+    }
+    fprintf(out, "metric,statistic,value\n");
+    fprintf(out, "system,total_time,%d\nsystem,processes,%zu\nsystem,cpu_utilization,%.4f\n"
+                 "system,memory_utilization,%.4f\nsystem,peak_fragmentation,%.4f\n",
+            globalClock, finishedProcesses.size(), cpuUtilization, averageMemoryUtilization, peakFragmentation);
+    for (int i = 0; i < 3; i++)
+    {
+        const metricsSummary &summary = summaries[i];
+        const char *name = timeNames[i];
+        fprintf(out, "%s,count,%lld\n", name, summary.count);
+        fprintf(out, "%s,mean,%.2f\n", name, summary.count > 0 ? (double)summary.total / summary.count : 0.0);
+        fprintf(out, "%s,p50,%lld\n%s,p90,%lld\n", name, summary.p50, name, summary.p90);
+        fprintf(out, "%s,p95,%lld\n%s,p99,%lld\n", name, summary.p95, name, summary.p99);
+        fprintf(out, "%s,max,%lld\n", name, summary.maximum);
+        for (size_t bucket = 0; bucket < summary.histogram.size(); bucket++)
+        {
+            fprintf(out, "%s,le_%lld,%lld\n", name, bucket == 0 ? 0LL : (1LL << bucket) - 1,
+                    summary.histogram[bucket]);
+        }
+    }
+    return fclose(out) == 0 && written;
 }
 
-int main()
+// Function to run every configuration of a sweep on a pool of threads
+// The jobs are parsed once and shared read-only; each configuration gets its
+// own simulation with logging off and the summary rows are printed as CSV in
+// grid order once every run has finished
+void runSweep(const simulatorOptions &options, const vector<PCB> &jobs, const hashIndex &priorities,
+              int maxMemory, int CPUAllocated, int switchTime)
 {
-    int maxMemory, CPUAllocated, switchTime, numProcesses;
-    list<memoryBlock> memoryList;
-    int globalClock = 0;
-    int totalCpuTime = 0;
-    queue<PCB> newJobQueue;
-    queue<int> readyQueue;
-    queue<IOWaitEntry> ioWaitQueue;
-    cin >> maxMemory >> CPUAllocated >> switchTime;
-    cin >> numProcesses;
-    memoryList.push_front(memoryBlock(-1, 0, maxMemory)); // Initialize memory list with a single free block of size maxMemory
-
-    vector<int> processStartTimes(numProcesses, -1); // Initialize with -1
+    vector<int> memories = options.sweepMemory.empty() ? vector<int>{maxMemory} : options.sweepMemory;
+    vector<int> quanta = options.sweepQuantum.empty() ? vector<int>{CPUAllocated} : options.sweepQuantum;
+    vector<int> switches = options.sweepSwitch.empty() ? vector<int>{switchTime} : options.sweepSwitch;
+    vector<simulationResult> rows;
+    for (int memorySize : memories)
+    {
+        for (int quantum : quanta)
+        {
+            for (int switchCost : switches)
+            {
+                rows.push_back({memorySize, quantum, switchCost, 0, 0, 0, 0, 0});
+            }
+        }
+    }
 
-    int *mainMemory = new int[maxMemory];
-    for (int i = 0; i < maxMemory; i++)
+    simulatorOptions runOptions = options;
+    runOptions.logLevel = LOG_OFF;
+    runOptions.metricsFile.clear();
+    runOptions.dumpAtStart = false;
+    runOptions.dumpTimes.clear();
+    runOptions.swapFile.clear(); // every run swaps to a file of its own
+    atomic<size_t> nextRow(0);
+    auto worker = [&]()
+    {
+        for (size_t i = nextRow++; i < rows.size(); i = nextRow++)
+        {
+            simulation sim(runOptions, rows[i].maxMemory, rows[i].CPUAllocated, rows[i].switchTime, priorities);
+            if (runOptions.paged && !sim.enablePaging(runOptions, runOptions.pageSize))
+            {
+                continue;
+            }
+            sim.newJobQueue.jobs = &jobs;
+            sim.run();
+            rows[i] = sim.result();
+        }
+    };
+    size_t threadCount = options.threads > 0 ? options.threads : max(1u, thread::hardware_concurrency());
+    vector<thread> pool;
+    for (size_t i = 0; i < min(threadCount, rows.size()); i++)
+    {
+        pool.emplace_back(worker);
+    }
+    for (thread &t : pool)
     {
-        mainMemory[i] = -1;
+        t.join();
     }
 
-    for (int i = 0; i < numProcesses; i++)
+    cout << "max_memory,cpu_allocated,switch_time,total_time,completed,avg_turnaround,avg_response"
+         << (options.paged ? ",page_faults\n" : "\n");
+    for (const simulationResult &row : rows)
     {
-        PCB newJob;
+        long long completed = max(row.completed, 1LL);
+        cout << row.maxMemory << ',' << row.CPUAllocated << ',' << row.switchTime << ',' << row.totalTime << ','
+             << row.completed << ',' << row.totalTurnaround / completed << ',' << row.totalResponse / completed;
+        if (options.paged)
+        {
+            cout << ',' << row.pageFaults;
+        }
+        cout << '\n';
+    }
+    cout.flush();
+}
+
+// Function to get the seconds elapsed since start
+double secondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
 
-        cin >> newJob.processID;
-        cin >> newJob.maxMemoryNeeded;
-        cin >> newJob.instructionSize;
+// Function to print one benchmark result
+void reportBenchmark(const char *name, long long items, const char *unit, double seconds)
+{
+    printf("%-24s %12lld %-13s %9.3f s %14.0f %s/s\n", name, items, unit, seconds,
+           seconds > 0 ? items / seconds : 0.0, unit);
+}
 
-        newJob.state = 1;
-        newJob.programCounter = 0;
-        newJob.cpuCyclesUsed = 0;
-        newJob.registerValue = 0;
-        newJob.startTime = -1;
-        newJob.endTime = -1;
-        newJob.memoryLimit = newJob.maxMemoryNeeded;
+// Function to run the microbenchmarks and end-to-end benchmarks
+// The end-to-end runs use the generated workload described by the spec,
+// the microbenchmarks derive their inputs from its seed
+void runBenchmarks(const simulatorOptions &options)
+{
+    const workloadSpec &spec = options.workload;
+    simulatorOptions runOptions = options;
+    runOptions.logLevel = LOG_OFF;
+    runOptions.metricsFile.clear();
+    runOptions.dumpAtStart = false;
+    runOptions.dumpTimes.clear();
+    hashIndex noPriorities;
+    vector<PCB> jobs;
+    generateJobs(spec, jobs);
+    long long instructions = 0;
+    for (const PCB &job : jobs)
+    {
+        instructions += job.instructionSize;
+    }
 
-        newJob.logicalMemory.clear();
-        for (int j = 0; j < newJob.instructionSize; j++)
+    // Allocator: random allocations and frees, coalescing when an allocation fails
+    {
+        const int OPERATIONS = 2000000;
+        const int sizes[2] = {1, 512};
+        memoryAllocator memoryList;
+        initMemoryAllocator(memoryList, 1 << 20);
+        workloadRandom random = {spec.seed};
+        vector<int> live;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < OPERATIONS; i++)
         {
-            int opcode;
-            cin >> opcode;
-            newJob.logicalMemory.push_back(opcode);
-            switch (opcode)
+            if (!live.empty() && (random.next() & 1))
             {
-            case 1:
+                size_t victim = random.next() % live.size();
+                releaseBlock(memoryList, live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+            else
             {
-                int iterations, cycles;
-                cin >> iterations >> cycles;
-                newJob.logicalMemory.push_back(iterations);
-                newJob.logicalMemory.push_back(cycles);
-                break;
+                int size = random.range(sizes);
+                int block = allocateBlock(memoryList, i, size);
+                if (block == -1 && coalesceFreeBlocks(memoryList))
+                {
+                    block = allocateBlock(memoryList, i, size);
+                }
+                if (block != -1)
+                {
+                    live.push_back(block);
+                }
             }
-            case 2:
+        }
+        reportBenchmark("allocate/release", OPERATIONS, "ops", secondsSince(start));
+    }
+
+    // Admission: loadJobsToMemory until memory is full, then free every resident job
+    {
+        simulation sim(runOptions, spec.maxMemory, spec.quantum, spec.switchTime, noPriorities);
+        sim.newJobQueue.jobs = &jobs;
+        sim.allocateMemory();
+        activeLog = &sim.log;
+        scheduler &readyQueue = sim.cores[0].readyQueue;
+        long long admissions = 0;
+        auto start = chrono::steady_clock::now();
+        while (!sim.newJobQueue.empty())
+        {
+            loadJobsToMemory(sim.newJobQueue, readyQueue, sim.mainMemory, sim.maxMemory, sim.memoryList,
+                             sim.processes, 0);
+            if (readyQueue.empty())
             {
-                int cycles;
-                cin >> cycles;
-                newJob.logicalMemory.push_back(cycles);
-                break;
+                break; // the next job is larger than memory
             }
-            case 3:
+            while (!readyQueue.empty())
             {
-                int value, address;
-                cin >> value >> address;
-                newJob.logicalMemory.push_back(value);
-                newJob.logicalMemory.push_back(address);
-                break;
+                int startAddress = readyQueue.pop().startAddress;
+                freeBlock(sim.processes.entries[findProcessAt(sim.processes, startAddress)].processID,
+                          sim.processes, sim.memoryList, sim.mainMemory, 0);
+                admissions++;
             }
-            case 4:
+        }
+        reportBenchmark("loadJobsToMemory", admissions, "admissions", secondsSince(start));
+        activeLog = NULL;
+    }
+
+    // IO queue: a fixed population of processes cycling through IO waits
+    {
+        const int WAITERS = 4096;
+        const int COMPLETIONS = 2000000;
+        processTable processes;
+        vector<memoryWord> memory(WAITERS * PCB_SIZE);
+        scheduler readyQueue;
+        readyQueue.processes = &processes;
+        ioTimerQueue ioWaitQueue;
+        eventLog log;
+        log.level = LOG_OFF;
+        activeLog = &log;
+        workloadRandom random = {spec.seed};
+        int clock = 0;
+        for (int i = 0; i < WAITERS; i++)
+        {
+            addProcess(processes, i + 1, -1, i * PCB_SIZE);
+            ioWaitQueue.push(i * PCB_SIZE, clock, random.range(spec.io));
+        }
+        long long completions = 0;
+        auto start = chrono::steady_clock::now();
+        while (completions < COMPLETIONS)
+        {
+            clock++;
+            checkIOWaitingQueue(ioWaitQueue, clock, readyQueue, memory.data(), processes);
+            while (!readyQueue.empty())
             {
-                int address;
-                cin >> address;
-                newJob.logicalMemory.push_back(address);
-                break;
+                ioWaitQueue.push(readyQueue.pop().startAddress, clock, random.range(spec.io));
+                completions++;
             }
+        }
+        reportBenchmark("checkIOWaitingQueue", completions, "completions", secondsSince(start));
+        activeLog = NULL;
+    }
+
+    // Dispatch: the same workload without Print, so executeCPU never waits for IO
+    {
+        workloadSpec computeSpec = spec;
+        computeSpec.mix[1] = 0;
+        int weights = 0;
+        for (int weight : computeSpec.mix)
+        {
+            weights += weight;
+        }
+        if (weights == 0)
+        {
+            computeSpec.mix[0] = 1;
+        }
+        vector<PCB> computeJobs;
+        generateJobs(computeSpec, computeJobs);
+        long long computeInstructions = 0;
+        for (const PCB &job : computeJobs)
+        {
+            computeInstructions += job.instructionSize;
+        }
+        simulation sim(runOptions, spec.maxMemory, spec.quantum, spec.switchTime, noPriorities);
+        sim.newJobQueue.jobs = &computeJobs;
+        auto start = chrono::steady_clock::now();
+        sim.run();
+        reportBenchmark("executeCPU", computeInstructions, "instructions", secondsSince(start));
+    }
+
+    // Bulk memory: Fill, Copy and Sum kernels over ranges of spec.bulk words
+    {
+        const int OPERATIONS = 2000000;
+        const int RANGE = 1 << 16;
+        vector<memoryWord> memory(2 * RANGE);
+        workloadRandom random = {spec.seed};
+        long long words = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < OPERATIONS; i++)
+        {
+            int count = min(random.range(spec.bulk), RANGE);
+            int first = random.next() % (RANGE - count + 1);
+            switch (i % 3)
+            {
+            case 0:
+                fillWords(memory.data(), first, count, i);
+                break;
+            case 1:
+                copyWords(memory.data(), first, first + RANGE, count);
+                break;
+            default:
+                memory[first] = sumWords(memory.data(), first, count); // kept, so the sum is not optimized away
+                break;
             }
+            words += count;
         }
-        newJobQueue.push(newJob);
+        reportBenchmark("bulk memory kernels", words, "words", secondsSince(start));
+    }
+
+    // End to end: the generated workload with logging off and with the full text log
+    for (int level : {LOG_OFF, LOG_INSTRUCTIONS})
+    {
+        runOptions.logLevel = level;
+        simulation sim(runOptions, spec.maxMemory, spec.quantum, spec.switchTime, noPriorities);
+        sim.newJobQueue.jobs = &jobs;
+        sim.log.out = fopen("/dev/null", "w");
+        auto start = chrono::steady_clock::now();
+        sim.run();
+        double seconds = secondsSince(start);
+        fclose(sim.log.out);
+        const char *name = level == LOG_OFF ? "end to end, log off" : "end to end, text log";
+        reportBenchmark(name, instructions, "instructions", seconds);
+        reportBenchmark(name, sim.result().completed, "admissions", seconds);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("peak RSS %ld KiB\n", usage.ru_maxrss);
+}
+
+int main(int argc, char *argv[])
+{
+    simulatorOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    if (!options.decodeFile.empty())
+    {
+        return decodeLog(options.decodeFile, options.logLevel) ? 0 : 1;
+    }
+    if (!options.decodeDumpFile.empty())
+    {
+        return decodeDump(options.decodeDumpFile) ? 0 : 1;
+    }
+    if (options.generate)
+    {
+        vector<PCB> jobs;
+        generateJobs(options.workload, jobs);
+        writeJobs(options.workload, jobs, stdout);
+        return 0;
+    }
+    if (options.bench)
+    {
+        runBenchmarks(options);
+        return 0;
     }
 
-    loadJobsToMemory(newJobQueue, readyQueue, mainMemory, maxMemory, memoryList);
+    int maxMemory, CPUAllocated, switchTime, numProcesses;
+    jobReader reader;
+    if (!openJobReader(reader, options.inputFile))
+    {
+        cerr << "Error: cannot open job file " << options.inputFile << "." << endl;
+        return 1;
+    }
+    if (!readInteger(reader, maxMemory) || !readInteger(reader, CPUAllocated) ||
+        !readInteger(reader, switchTime) || !readInteger(reader, numProcesses))
+    {
+        cerr << "Error: job input is missing its header." << endl;
+        return 1;
+    }
+    reader.jobsLeft = numProcesses;
+    if (options.quantumOverride >= 0)
+    {
+        CPUAllocated = options.quantumOverride;
+    }
+    if (options.switchOverride >= 0)
+    {
+        switchTime = options.switchOverride;
+    }
 
-    // Memory dump
-    for (int i = 0; i < maxMemory; i++)
+    hashIndex priorities;
+    if (!options.prioritiesFile.empty() && !readPriorities(options.prioritiesFile, priorities))
     {
-        cout << i << " : " << mainMemory[i] << endl;
+        cerr << "Error: cannot read priorities file " << options.prioritiesFile << "." << endl;
+        return 1;
     }
 
-    while (!readyQueue.empty() || !ioWaitQueue.empty() || !newJobQueue.empty())
+    if (options.sweep)
     {
-        if (!readyQueue.empty())
+        vector<PCB> jobs;
+        PCB newJob;
+        while (readJob(reader, newJob))
         {
-            globalClock += switchTime;
-            int startAddress = readyQueue.front();
-            readyQueue.pop();
-            cout << "Process " << mainMemory[startAddress] << " has moved to Running." << endl;
-            executeCPU(startAddress, mainMemory, CPUAllocated, globalClock, ioWaitQueue, readyQueue, totalCpuTime, processStartTimes, memoryList, maxMemory, newJobQueue);
-            checkIOWaitingQueue(ioWaitQueue, globalClock, readyQueue, mainMemory);
+            jobs.push_back(move(newJob));
         }
-        else if (!ioWaitQueue.empty())
+        if (reader.failed)
         {
-            globalClock += switchTime;
-            checkIOWaitingQueue(ioWaitQueue, globalClock, readyQueue, mainMemory);
+            cerr << "Error: job input is malformed or truncated, remaining jobs ignored." << endl;
         }
-        else if (!newJobQueue.empty())
+        closeJobReader(reader);
+        runSweep(options, jobs, priorities, maxMemory, CPUAllocated, switchTime);
+        return 0;
+    }
+
+    simulation sim(options, maxMemory, CPUAllocated, switchTime, priorities);
+    if (!options.logFile.empty())
+    {
+        sim.log.out = fopen(options.logFile.c_str(), sim.log.binary ? "wb" : "w");
+        if (sim.log.out == NULL)
         {
-            globalClock += switchTime;
-            loadJobsToMemory(newJobQueue, readyQueue, mainMemory, maxMemory, memoryList);
+            cerr << "Error: cannot open log file " << options.logFile << "." << endl;
+            return 1;
         }
     }
+    sim.log.buffer.reserve(LOG_FLUSH_SIZE + 4096);
+    if (sim.log.binary)
+    {
+        appendBinary(sim.log.buffer, LOG_MAGIC, sizeof(LOG_MAGIC));
+    }
+    sim.newJobQueue.reader = &reader;
+    sim.newJobQueue.lookahead = options.preloadJobs ? (size_t)-1 : 1;
+    if (options.paged && options.restoreFile.empty() && !sim.enablePaging(options, options.pageSize))
+    {
+        return 1;
+    }
+    if (!options.restoreFile.empty() && !sim.restoreCheckpoint(options.restoreFile, options))
+    {
+        cerr << "Error: cannot restore checkpoint " << options.restoreFile << "." << endl;
+        return 1;
+    }
+    if (!options.checkpointFile.empty())
+    {
+        signal(SIGUSR1, requestCheckpoint);
+    }
+    signal(SIGUSR2, requestDump);
+    if (options.logThread && sim.log.level > LOG_OFF)
+    {
+        startLogWriter(sim.log);
+    }
+    sim.run();
+    stopLogWriter(sim.log);
 
-    globalClock += switchTime;
-    cout << "Total CPU time used: " << globalClock << "." << endl;
-
-    delete[] mainMemory;
+    if (sim.log.out != stdout)
+    {
+        fclose(sim.log.out);
+    }
+    closeJobReader(reader);
     return 0;
 }